@@ -30,92 +30,82 @@
 extern "C" {
 #endif
 
-void aligned_block_read_neon(int64_t * __restrict dst,
-                             int64_t * __restrict src,
-                             int                  size);
-
-void aligned_block_read_pf32_neon(int64_t * __restrict dst,
-                                  int64_t * __restrict src,
-                                  int                  size);
-void aligned_block_read_pf64_neon(int64_t * __restrict dst,
-                                  int64_t * __restrict src,
-                                  int                  size);
-
-void aligned_block_read2_neon(int64_t * __restrict dst,
-                              int64_t * __restrict src,
-                              int                  size);
-
-void aligned_block_read2_pf32_neon(int64_t * __restrict dst,
-                                   int64_t * __restrict src,
-                                   int                  size);
-void aligned_block_read2_pf64_neon(int64_t * __restrict dst,
-                                   int64_t * __restrict src,
-                                   int                  size);
-
-void aligned_block_copy_neon(int64_t * __restrict dst,
-                             int64_t * __restrict src,
-                             int                  size);
-
-void aligned_block_copy_vfp(int64_t * __restrict dst,
-                            int64_t * __restrict src,
-                            int                  size);
-
-void aligned_block_copy_pf32_neon(int64_t * __restrict dst,
-                                  int64_t * __restrict src,
-                                  int                  size);
-void aligned_block_copy_pf64_neon(int64_t * __restrict dst,
-                                  int64_t * __restrict src,
-                                  int                  size);
-
-void aligned_block_copy_unrolled_neon(int64_t * __restrict dst,
-                                      int64_t * __restrict src,
-                                      int                  size);
-
-void aligned_block_copy_unrolled_pf32_neon(int64_t * __restrict dst,
-                                           int64_t * __restrict src,
-                                           int                  size);
-void aligned_block_copy_unrolled_pf64_neon(int64_t * __restrict dst,
-                                           int64_t * __restrict src,
-                                           int                  size);
-
-void aligned_block_copy_backwards_neon(int64_t * __restrict dst,
-                                       int64_t * __restrict src,
-                                       int                  size);
-
-void aligned_block_copy_backwards_pf32_neon(int64_t * __restrict dst,
-                                            int64_t * __restrict src,
-                                            int                  size);
-void aligned_block_copy_backwards_pf64_neon(int64_t * __restrict dst,
-                                            int64_t * __restrict src,
-                                            int                  size);
-
-void aligned_block_fill_neon(int64_t * __restrict dst,
-                             int64_t * __restrict src,
-                             int                  size);
-
-void aligned_block_fill_backwards_neon(int64_t * __restrict dst,
-                                       int64_t * __restrict src,
-                                       int                  size);
-
-void aligned_block_copy_incr_armv5te(int64_t * __restrict dst,
-                                     int64_t * __restrict src,
-                                     int                  size);
-
-void aligned_block_copy_wrap_armv5te(int64_t * __restrict dst,
-                                     int64_t * __restrict src,
-                                     int                  size);
-
-void aligned_block_fill_strd_armv5te(int64_t * __restrict dst,
-                                     int64_t * __restrict src,
-                                     int                  size);
-
-void aligned_block_fill_stm4_armv4(int64_t * __restrict dst,
-                                   int64_t * __restrict src,
-                                   int                  size);
+/*
+ * The list of all the routines from arm-neon.S, which is used both for the
+ * prototypes below and for the lima-memspeed workloads table:
+ *
+ *   X(function, workload name, required cpu feature,
+ *     bytes read, bytes written, description)
+ *
+ * The byte counts are per byte of the 'size' argument, so a copy reads and
+ * writes 'size' bytes (1, 1) and a fill only writes them (0, 1).
+ */
+#define ARM_ASM_KERNELS(X) \
+	X(aligned_block_read_neon, "neon_read", neon, 1, 0, \
+	  "use ARM NEON to read from a memory buffer") \
+	X(aligned_block_read_pf32_neon, "neon_read_pf32", neon, 1, 0, \
+	  "use ARM NEON to read from a memory buffer, prefetch every 32 bytes") \
+	X(aligned_block_read_pf64_neon, "neon_read_pf64", neon, 1, 0, \
+	  "use ARM NEON to read from a memory buffer, prefetch every 64 bytes") \
+	X(aligned_block_copy_neon, "neon_copy", neon, 1, 1, \
+	  "use ARM NEON to copy a memory buffer") \
+	X(aligned_block_copy_vfp, "vfp_copy", vfp, 1, 1, \
+	  "use ARM VFP to copy a memory buffer") \
+	X(aligned_block_copy_pf32_neon, "neon_copy_pf32", neon, 1, 1, \
+	  "use ARM NEON to copy a memory buffer, prefetch every 32 bytes") \
+	X(aligned_block_copy_pf64_neon, "neon_copy_pf64", neon, 1, 1, \
+	  "use ARM NEON to copy a memory buffer, prefetch every 64 bytes") \
+	X(aligned_block_copy_unrolled_neon, "neon_copy_unrolled", neon, 1, 1, \
+	  "use ARM NEON to copy a memory buffer, unrolled") \
+	X(aligned_block_copy_unrolled_pf32_neon, "neon_copy_unrolled_pf32", \
+	  neon, 1, 1, \
+	  "use ARM NEON to copy a memory buffer, unrolled, prefetch every 32 bytes") \
+	X(aligned_block_copy_unrolled_pf64_neon, "neon_copy_unrolled_pf64", \
+	  neon, 1, 1, \
+	  "use ARM NEON to copy a memory buffer, unrolled, prefetch every 64 bytes") \
+	X(aligned_block_copy_backwards_neon, "neon_copy_backwards", neon, 1, 1, \
+	  "use ARM NEON to copy a memory buffer backwards") \
+	X(aligned_block_copy_backwards_pf32_neon, "neon_copy_backwards_pf32", \
+	  neon, 1, 1, \
+	  "use ARM NEON to copy a memory buffer backwards, prefetch every 32 bytes") \
+	X(aligned_block_copy_backwards_pf64_neon, "neon_copy_backwards_pf64", \
+	  neon, 1, 1, \
+	  "use ARM NEON to copy a memory buffer backwards, prefetch every 64 bytes") \
+	X(aligned_block_fill_neon, "neon_write", neon, 0, 1, \
+	  "use ARM NEON to fill a memory buffer") \
+	X(aligned_block_fill_backwards_neon, "neon_write_backwards", neon, 0, 1, \
+	  "use ARM NEON to fill a memory buffer backwards") \
+	X(aligned_block_copy_incr_armv5te, "armv5te_copy_incr", armv5te, 1, 1, \
+	  "use LDM/STM to copy a memory buffer, incrementing PLD") \
+	X(aligned_block_copy_wrap_armv5te, "armv5te_copy_wrap", armv5te, 1, 1, \
+	  "use LDM/STM to copy a memory buffer, wrapping PLD") \
+	X(aligned_block_fill_strd_armv5te, "armv5te_fill_strd", armv5te, 0, 1, \
+	  "use STRD to fill a memory buffer") \
+	X(aligned_block_fill_stm4_armv4, "armv4_fill_stm4", armv4, 0, 1, \
+	  "use STM of 4 registers to fill a memory buffer") \
+	X(aligned_block_fill_stm8_armv4, "armv4_fill_stm8", armv4, 0, 1, \
+	  "use STM of 8 registers to fill a memory buffer")
 
-void aligned_block_fill_stm8_armv4(int64_t * __restrict dst,
-                                   int64_t * __restrict src,
-                                   int                  size);
+/*
+ * The read2 routines read 64 bytes from 'src' and then 64 bytes from 'dst'
+ * for every 128 bytes of 'size', so each buffer gets 'size' / 2 bytes read.
+ * lima-memspeed runs them over two separate arrays, the byte counts are
+ * per byte of each array.
+ */
+#define ARM_ASM_READ2_KERNELS(X) \
+	X(aligned_block_read2_neon, "neon_read2", neon, 2, 0, \
+	  "use ARM NEON to read from two memory buffers") \
+	X(aligned_block_read2_pf32_neon, "neon_read2_pf32", neon, 2, 0, \
+	  "use ARM NEON to read from two memory buffers, prefetch every 32 bytes") \
+	X(aligned_block_read2_pf64_neon, "neon_read2_pf64", neon, 2, 0, \
+	  "use ARM NEON to read from two memory buffers, prefetch every 64 bytes")
+
+#define ARM_ASM_KERNEL_PROTOTYPE(function, name, feature, rd, wr, desc) \
+	void function(int64_t * __restrict dst, int64_t * __restrict src, \
+	              int size);
+
+ARM_ASM_KERNELS(ARM_ASM_KERNEL_PROTOTYPE)
+ARM_ASM_READ2_KERNELS(ARM_ASM_KERNEL_PROTOTYPE)
 
 #ifdef __cplusplus
 }
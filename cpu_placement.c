@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * CPU affinity and NUMA memory placement helpers. The set_mempolicy system
+ * call is invoked directly (there is no libnuma in the static builds) and
+ * everything degrades to a no-op on single node systems or on kernels
+ * without NUMA support.
+ */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/syscall.h>
+
+#include "cpu_placement.h"
+
+#define MPOL_BIND	2
+#define MAX_NUMA_NODES	64
+
+static int parse_cpu_list(const char *str, cpu_set_t *set)
+{
+	char *end;
+	long first, last;
+
+	CPU_ZERO(set);
+	while (*str && *str != '\n') {
+		first = strtol(str, &end, 10);
+		if (end == str || first < 0)
+			return -1;
+		last = first;
+		if (*end == '-') {
+			str = end + 1;
+			last = strtol(str, &end, 10);
+			if (end == str || last < first)
+				return -1;
+		}
+		if (last >= CPU_SETSIZE)
+			return -1;
+		for (; first <= last; first++)
+			CPU_SET(first, set);
+		if (*end == ',')
+			end++;
+		else if (*end && *end != '\n')
+			return -1;
+		str = end;
+	}
+	return CPU_COUNT(set) ? 0 : -1;
+}
+
+static void format_cpu_list(const cpu_set_t *set, char *buf, size_t size)
+{
+	int cpu, first = -1;
+	size_t len = 0;
+
+	buf[0] = 0;
+	for (cpu = 0; cpu <= CPU_SETSIZE; cpu++) {
+		int isset = cpu < CPU_SETSIZE && CPU_ISSET(cpu, set);
+		if (isset && first < 0)
+			first = cpu;
+		if (isset || first < 0)
+			continue;
+		if (len < size)
+			len += snprintf(buf + len, size - len, "%s%d",
+					len ? "," : "", first);
+		if (cpu - 1 > first && len < size)
+			len += snprintf(buf + len, size - len, "-%d", cpu - 1);
+		first = -1;
+	}
+}
+
+int cpu_list_count(const char *cpulist)
+{
+	cpu_set_t set;
+
+	if (parse_cpu_list(cpulist, &set) < 0)
+		return -1;
+	return CPU_COUNT(&set);
+}
+
+int pin_current_thread(const char *cpulist, int n)
+{
+	cpu_set_t set, one;
+	int cpu;
+
+	if (parse_cpu_list(cpulist, &set) < 0)
+		return -1;
+	if (n >= 0) {
+		n %= CPU_COUNT(&set);
+		for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &set) && n-- == 0)
+				break;
+		}
+		CPU_ZERO(&one);
+		CPU_SET(cpu, &one);
+		set = one;
+	}
+	if (sched_setaffinity(0, sizeof(cpu_set_t), &set) < 0) {
+		fprintf(stderr, "Failed to set cpu affinity: %s\n",
+			strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+int cpu_outside_list(const char *cpulist)
+{
+	cpu_set_t set, allowed;
+	int cpu;
+
+	if (parse_cpu_list(cpulist, &set) < 0 ||
+	    sched_getaffinity(0, sizeof(cpu_set_t), &allowed) < 0)
+		return -1;
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &allowed) && !CPU_ISSET(cpu, &set))
+			return cpu;
+	}
+	return -1;
+}
+
+static int read_sysfs_string(const char *path, char *buf, size_t size)
+{
+	FILE *f = fopen(path, "r");
+	if (!f)
+		return -1;
+	if (!fgets(buf, size, f)) {
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	buf[strcspn(buf, "\n")] = 0;
+	return 0;
+}
+
+static long read_sysfs_long(const char *path, long fallback)
+{
+	char buf[64];
+	if (read_sysfs_string(path, buf, sizeof(buf)) < 0)
+		return fallback;
+	return strtol(buf, NULL, 10);
+}
+
+int numa_node_count(void)
+{
+	char buf[256];
+	cpu_set_t nodes;
+	int node, count = 1;
+
+	/* The node list has the same format as the cpu lists */
+	if (read_sysfs_string("/sys/devices/system/node/online",
+			      buf, sizeof(buf)) < 0 ||
+	    parse_cpu_list(buf, &nodes) < 0)
+		return 1;
+	for (node = 0; node < MAX_NUMA_NODES; node++) {
+		if (CPU_ISSET(node, &nodes))
+			count = node + 1;
+	}
+	return count;
+}
+
+int numa_bind_thread_memory(int node)
+{
+	unsigned long nodemask[MAX_NUMA_NODES / (8 * sizeof(long))] = { 0 };
+
+	if (node < 0 || node >= MAX_NUMA_NODES)
+		return -1;
+	nodemask[node / (8 * sizeof(long))] = 1UL << (node % (8 * sizeof(long)));
+#ifdef SYS_set_mempolicy
+	/* The kernel expects the number of bits in the mask plus one */
+	if (syscall(SYS_set_mempolicy, MPOL_BIND, nodemask,
+		    MAX_NUMA_NODES + 1) == 0)
+		return 0;
+#else
+	errno = ENOSYS;
+#endif
+	fprintf(stderr, "Failed to bind memory to node %d: %s\n", node,
+		strerror(errno));
+	return -1;
+}
+
+long cpu_cache_size(int level)
+{
+	char path[128], buf[64];
+	char *suffix;
+	int cpu = sched_getcpu(), index;
+	long size;
+
+	if (cpu < 0)
+		cpu = 0;
+	for (index = 0; ; index++) {
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/cache/index%d/level",
+			 cpu, index);
+		if (read_sysfs_string(path, buf, sizeof(buf)) < 0)
+			return 0;
+		if (strtol(buf, NULL, 10) != level)
+			continue;
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/cache/index%d/type",
+			 cpu, index);
+		if (read_sysfs_string(path, buf, sizeof(buf)) < 0 ||
+		    !strcmp(buf, "Instruction"))
+			continue;
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/cache/index%d/size",
+			 cpu, index);
+		if (read_sysfs_string(path, buf, sizeof(buf)) < 0)
+			return 0;
+		size = strtol(buf, &suffix, 10);
+		if (*suffix == 'K')
+			size <<= 10;
+		else if (*suffix == 'M')
+			size <<= 20;
+		return size;
+	}
+}
+
+void print_cpu_topology(void)
+{
+	char path[128], buf[256];
+	cpu_set_t online, done, cluster;
+	long cluster_id[CPU_SETSIZE], max_freq[CPU_SETSIZE];
+	int node, nodes = numa_node_count(), cpu, other;
+
+	if (read_sysfs_string("/sys/devices/system/cpu/online",
+			      buf, sizeof(buf)) < 0 ||
+	    parse_cpu_list(buf, &online) < 0) {
+		printf("CPU topology is unknown\n");
+		return;
+	}
+
+	printf("CPU topology: %d NUMA node%s\n", nodes, nodes > 1 ? "s" : "");
+	for (node = 0; node < nodes && nodes > 1; node++) {
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/node/node%d/cpulist", node);
+		if (read_sysfs_string(path, buf, sizeof(buf)) < 0)
+			continue;
+		printf("  node %d: cpus %s\n", node, buf[0] ? buf : "none");
+	}
+
+	/* Group the cpus by cluster and the maximal clock frequency */
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (!CPU_ISSET(cpu, &online))
+			continue;
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/topology/cluster_id", cpu);
+		cluster_id[cpu] = read_sysfs_long(path, -1);
+		if (cluster_id[cpu] == -1) {
+			snprintf(path, sizeof(path),
+				 "/sys/devices/system/cpu/cpu%d/topology/physical_package_id",
+				 cpu);
+			cluster_id[cpu] = read_sysfs_long(path, 0);
+		}
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq",
+			 cpu);
+		max_freq[cpu] = read_sysfs_long(path, 0);
+	}
+
+	CPU_ZERO(&done);
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (!CPU_ISSET(cpu, &online) || CPU_ISSET(cpu, &done))
+			continue;
+		CPU_ZERO(&cluster);
+		for (other = cpu; other < CPU_SETSIZE; other++) {
+			if (CPU_ISSET(other, &online) &&
+			    cluster_id[other] == cluster_id[cpu] &&
+			    max_freq[other] == max_freq[cpu]) {
+				CPU_SET(other, &cluster);
+				CPU_SET(other, &done);
+			}
+		}
+		format_cpu_list(&cluster, buf, sizeof(buf));
+		printf("  cluster %ld: cpus %s", cluster_id[cpu], buf);
+		if (max_freq[cpu])
+			printf(", up to %ld MHz", max_freq[cpu] / 1000);
+		printf("\n");
+	}
+}
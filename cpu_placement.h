@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CPU_PLACEMENT_H
+#define CPU_PLACEMENT_H
+
+/* The number of cpus in a list using the sysfs format ("0-3,6") or -1 if
+   the list can't be parsed */
+int cpu_list_count(const char *cpulist);
+
+/* Pin the calling thread to the cpus from the list. If 'n' is not negative,
+   then only the n-th cpu (wrapping around) from the list is used. */
+int pin_current_thread(const char *cpulist, int n);
+
+/* The first cpu which the calling thread is allowed to run on and which is
+   not in the list, or -1 if there is none */
+int cpu_outside_list(const char *cpulist);
+
+/* The number of NUMA nodes (1 if the kernel has no NUMA support) */
+int numa_node_count(void);
+
+/* Allocate all the memory of the calling thread on the given node */
+int numa_bind_thread_memory(int node);
+
+/* The size in bytes of the data (or unified) cache of the given level used
+   by the calling cpu, or 0 if it is not reported by the kernel */
+long cpu_cache_size(int level);
+
+/* Print the NUMA nodes and the cpu clusters (big.LITTLE) to stdout */
+void print_cpu_topology(void);
+
+#endif
@@ -30,14 +30,25 @@
 #include <assert.h>
 #include <math.h>
 #include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "limare.h"
 #include "formats.h"
 
 #include "lima-memspeed.h"
-#include "arm-neon.h"
+#include "memspeed_cpu.h"
+#include "memspeed_sweep.h"
+#include "memspeed_latency.h"
+#include "memspeed_timeseries.h"
+#include "memspeed_stats.h"
+#include "memspeed_report.h"
+#include "cpu_placement.h"
 #include "memspeed_gpu.h"
 #include "memspeed_fb.h"
+#include "perf_counters.h"
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(a)  (sizeof((a)) / sizeof((a)[0]))
@@ -51,39 +62,19 @@ double gettime(void)
 	return t.tv_sec + 0.000000001 * t.tv_nsec;
 }
 
-pthread_mutex_t bandwidth_counters_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-/******************************************************************************/
-
-#define BUFFER_SIZE (32 * 1024 * 1024)
-
-static void *cpu_thread(void *data)
+workload_t *alloc_workloads(int n)
 {
-	workload_t *w = (workload_t *)data;
-	void (*f)(int64_t *, int64_t *, int) = w->extra_data;
-	int64_t *buffer;
-	int size_multiplier = w->size_multiplier;
-	if (!size_multiplier)
-		size_multiplier = 1;
-
-	if (posix_memalign((void **)&buffer, 4096, BUFFER_SIZE) != 0) {
+	workload_t *workloads;
+	if (posix_memalign((void **)&workloads, CACHE_LINE_SIZE,
+			   n * sizeof(workload_t)) != 0) {
 		assert(0);
 	}
-	memset(buffer, 0xCC, BUFFER_SIZE);
-
-	while (1) {
-		f(buffer, buffer, BUFFER_SIZE);
-
-		pthread_mutex_lock(&bandwidth_counters_mutex);
-		w->bytes_counter += BUFFER_SIZE * size_multiplier;
-		pthread_mutex_unlock(&bandwidth_counters_mutex);
-	}
-
-	free(buffer);
-
-	return 0;
+	memset(workloads, 0, n * sizeof(workload_t));
+	return workloads;
 }
 
+/******************************************************************************/
+
 static workload_t workloads_list[] = {
 	{
 		.name = "fb_blank",
@@ -105,144 +96,1159 @@ static workload_t workloads_list[] = {
 		.description = "use the lima driver to copy a texture to the screen",
 		.thread_func = gpu_copy_thread,
 	},
-#ifdef __ARM__
-	{
-		.name = "neon_write",
-		.description = "use ARM NEON to fill a memory buffer",
-		.thread_func = cpu_thread,
-		.extra_data = aligned_block_fill_neon,
-	},
 	{
-		.name = "neon_write_backwards",
-		.description = "use ARM NEON to fill a memory buffer",
-		.thread_func = cpu_thread,
-		.extra_data = aligned_block_fill_backwards_neon,
+		.name = "gpu_tex_8888_x4",
+		.description = "four layers of screen sized RGBA8888 textured quads",
+		.thread_func = gpu_texture_thread,
 	},
 	{
-		.name = "neon_read_pf32",
-		.description = "use ARM NEON to read from a memory buffer",
-		.thread_func = cpu_thread,
-		.extra_data = aligned_block_read_pf32_neon,
+		.name = "gpu_tex_8888_x4_depth",
+		.description = "the same, but the depth test hides all the layers but one",
+		.thread_func = gpu_texture_thread,
 	},
 	{
-		.name = "neon_read_pf64",
-		.description = "use ARM NEON to read from a memory buffer",
-		.thread_func = cpu_thread,
-		.extra_data = aligned_block_read_pf64_neon,
+		.name = "gpu_tex_565_s256_x8_blend",
+		.description = "eight blended layers of a 256x256 RGB565 texture",
+		.thread_func = gpu_texture_thread,
 	},
 	{
-		.name = "neon_copy_pf64",
-		.description = "use ARM NEON to copy a memory buffer",
-		.thread_func = cpu_thread,
-		.extra_data = aligned_block_copy_pf64_neon,
-		.size_multiplier = 2,
+		.name = "gpu_tex_888_mip",
+		.description = "a screen sized RGB888 texture with mipmaps",
+		.thread_func = gpu_texture_thread,
 	},
-#endif
 };
 
+/* The cpus for pinning the CPU workload threads (the '-a' option) */
+static const char *cpulist;
+static int number_of_cpu_threads;
+
+/* The sampling interval of the '--timeseries' option (seconds) */
+static double timeseries_interval;
+
+/* Count the hardware events of the workload threads ('--perf') */
+static int use_perf_counters;
+
+/* The measurement policy ('--warmup', '--interval', '--ci', '--max-time') */
+static double max_warmup_time = 10;
+static double sample_interval = 2;
+static double ci_target = 0.4;
+static double max_duration = 30;
+
+#define WARMUP_STEP      0.25
+#define WARMUP_PROBES    4
+#define WARMUP_TOLERANCE 3.0
+#define MIN_SAMPLES      3
+
+#define PACE_SPIN_TIME   0.0002
+#define PACE_MAX_BACKLOG 0.05
+
+/* The workloads above, followed by the cpu kernels supported at runtime */
+static workload_t *available_workloads;
+static int number_of_available_workloads;
+
+static void init_available_workloads(void)
+{
+	int j, n = 0;
+
+	available_workloads = alloc_workloads(ARRAY_SIZE(workloads_list) +
+					      cpu_kernels_count);
+
+	for (j = 0; j < ARRAY_SIZE(workloads_list); j++)
+		available_workloads[n++] = workloads_list[j];
+
+	for (j = 0; j < cpu_kernels_count; j++) {
+		if (!cpu_kernel_supported(&cpu_kernels[j]))
+			continue;
+		available_workloads[n].name = cpu_kernels[j].name;
+		available_workloads[n].description = cpu_kernels[j].description;
+		available_workloads[n].thread_func = cpu_thread;
+		available_workloads[n].extra_data = (void *)&cpu_kernels[j];
+		n++;
+	}
+	number_of_available_workloads = n;
+}
+
+static void list_cpu_kernels_and_exit(void)
+{
+	int j;
+	printf("%-26s %5s %5s %6s  %-8s %s\n", "name", "read", "write",
+	       "arrays", "feature", "available");
+	for (j = 0; j < cpu_kernels_count; j++) {
+		printf("%-26s %5d %5d %6d  %-8s %s\n", cpu_kernels[j].name,
+		       cpu_kernels[j].read_multiplier,
+		       cpu_kernels[j].write_multiplier,
+		       cpu_kernel_arrays(&cpu_kernels[j]), cpu_kernels[j].feature,
+		       cpu_kernel_supported(&cpu_kernels[j]) ? "yes" : "no");
+	}
+	printf("\nThe read and write columns are the bytes transferred per byte\n");
+	printf("of the buffer size in each pass over the buffer. The kernels\n");
+	printf("with several arrays use a separate 32M buffer for each one.\n");
+	exit(0);
+}
+
 static void show_help_and_exit(void)
 {
 	int j;
-	printf("Usage: lima-memspeed [workload1] [workload2] ... [workloadN]\n\n");
+	printf("Usage: lima-memspeed [options] [workload1] [workload2] ... [workloadN]\n");
+	printf("       lima-memspeed --list\n");
+	printf("       lima-memspeed --latency [workload1] ... [workloadN]\n\n");
 
 	printf("Where the 'workload' arguments are the identifiers of different\n");
 	printf("memory bandwidth consuming workloads. Each workload is run in its\n");
-	printf("own thread.\n\n");
-	
+	printf("own thread. The '--list' option shows the properties of the\n");
+	printf("CPU workloads, including the ones not supported by this cpu.\n\n");
+
+	printf("Options:\n");
+	printf("\t--sweep          run each (CPU) workload alone over buffer sizes\n");
+	printf("\t                 from 4K to 256M instead of the 32M buffer\n");
+	printf("\t--hugepages      back the --sweep buffer with huge pages\n");
+	printf("\t--latency        measure the memory latency over buffer sizes\n");
+	printf("\t                 from 4K to 256M with 4K and with huge pages,\n");
+	printf("\t                 while the given workloads (if any) keep\n");
+	printf("\t                 running as the load\n");
+	printf("\t--latency-cpu N  walk the latency chain on cpu N (by default\n");
+	printf("\t                 on the first cpu outside of the -a list)\n");
+	printf("\t--matrix         measure each workload alone and with every\n");
+	printf("\t                 other one and print the slowdown matrix\n");
+	printf("\t--triples        also measure all the triples of workloads\n");
+	printf("\t--fb-check       compare the bandwidth of the workloads with\n");
+	printf("\t                 the screen blanked and unblanked against the\n");
+	printf("\t                 estimated framebuffer scanout bandwidth\n");
+	printf("\t-j N             run N threads of each CPU workload, pinned to\n");
+	printf("\t                 different cpus\n");
+	printf("\t-j M..N          measure with M, M+1, ..., N threads of each CPU\n");
+	printf("\t                 workload (the other workloads run in a single\n");
+	printf("\t                 thread) and find the saturation point\n");
+	printf("\t-a cpulist       pin the CPU workload threads to these cpus\n");
+	printf("\t                 (\"0-3,6\", all the online cpus by default)\n");
+	printf("\t--perf           also count the cycles, instructions, cache,\n");
+	printf("\t                 TLB misses and bus accesses of each workload\n");
+	printf("\t                 thread with the hardware performance counters\n");
+	printf("\t--timeseries MS  also sample the bandwidth of every workload\n");
+	printf("\t                 thread each MS milliseconds (10 or more) and\n");
+	printf("\t                 print the time series after the measurement\n");
+	printf("\t--warmup SEC     wait up to SEC seconds (default 10) for the\n");
+	printf("\t                 bandwidth to become stable before measuring,\n");
+	printf("\t                 0 disables the warm-up\n");
+	printf("\t--interval SEC   the length of each sample (default 2)\n");
+	printf("\t--ci PERCENT     stop when the 95%% confidence interval of the\n");
+	printf("\t                 mean is within PERCENT of it (default 0.4)\n");
+	printf("\t--max-time SEC   stop measuring after SEC seconds (default 30)\n");
+	printf("\t--json FILE      also write the results with all the samples,\n");
+	printf("\t                 the thread placement, the buffer sizes, the\n");
+	printf("\t                 framebuffer mode and the GPU frame counts\n");
+	printf("\t                 to FILE in the JSON format\n");
+	printf("\t--csv FILE       write the results to FILE in the CSV format\n");
+	printf("\t                 (one row per workload thread)\n");
+	printf("\t                 --json and --csv can't be combined with\n");
+	printf("\t                 --sweep, --latency and --fb-check\n\n");
+
+	printf("A workload can be limited to a target rate by appending\n");
+	printf("'@rate' to its identifier, for example 'neon_read_pf64@800M'\n");
+	printf("for 800 MB/s. The other workloads still run at full speed.\n\n");
+
+	printf("The 'gpu_tex' workloads take their parameters from the\n");
+	printf("identifier, 'gpu_tex' followed by any of '_565', '_888' or\n");
+	printf("'_8888' (the texture format), '_sN' (an N x N texture instead\n");
+	printf("of a screen sized one), '_xN' (N layers of overdraw), '_blend',\n");
+	printf("'_depth' (depth test), '_nearest' (filtering) and '_mip'\n");
+	printf("(mipmaps), for example 'gpu_tex_565_s512_x4_blend'.\n\n");
+
 	printf("The list of available workload identifiers:\n");
 
-	for (j = 0; j < ARRAY_SIZE(workloads_list); j++) {
-		if (workloads_list[j].description)
-			printf("\t%-30s (%s)\n", workloads_list[j].name,
-						 workloads_list[j].description);
+	for (j = 0; j < number_of_available_workloads; j++) {
+		if (available_workloads[j].description)
+			printf("\t%-30s (%s)\n", available_workloads[j].name,
+						 available_workloads[j].description);
 		else
-			printf("\t%s\n", workloads_list[j].name);
+			printf("\t%s\n", available_workloads[j].name);
 	}
 	exit(1);
 }
 
+/* The hardware counters are opened by the workload thread itself */
+static void *perf_workload_thread(void *data)
+{
+	workload_t *w = (workload_t *)data;
+	perf_counters_open(&w->perf);
+	__atomic_store_n(&w->perf_ready, 1, __ATOMIC_RELEASE);
+	return w->thread_func(w);
+}
+
+static void start_workload_thread(workload_t *w)
+{
+	if (w->thread_func == cpu_thread && cpulist)
+		w->cpu_index = number_of_cpu_threads++;
+	else
+		w->cpu_index = -1;
+	w->cpulist = cpulist;
+	w->cpu = -1;
+	perf_counters_init(&w->perf);
+	printf("Starting '%s' thread\n", w->name);
+	if (!use_perf_counters) {
+		pthread_create(&w->thread_id, NULL, w->thread_func, w);
+		return;
+	}
+	/* the counting starts before any measurement even without warm-up */
+	w->perf_ready = 0;
+	pthread_create(&w->thread_id, NULL, perf_workload_thread, w);
+	while (!__atomic_load_n(&w->perf_ready, __ATOMIC_ACQUIRE))
+		sched_yield();
+}
+
+static void sleep_seconds(double seconds)
+{
+	struct timespec t;
+	t.tv_sec = (time_t)seconds;
+	t.tv_nsec = (long)((seconds - t.tv_sec) * 1e9);
+	nanosleep(&t, NULL);
+}
+
+/*
+ * The pacing of the rate limited workloads. It is a control loop on the
+ * total: the thread sleeps until the time when the bytes done so far are
+ * due at the target rate, so the errors of the sleeps do not accumulate.
+ * If the thread falls behind (for example, when it was not scheduled),
+ * at most PACE_MAX_BACKLOG seconds are caught up at full speed. For the
+ * GPU workloads the counter is written by limare's notification thread
+ * rather than by the pacing one, so it is read atomically.
+ */
+void workload_pace(workload_t *w)
+{
+	double now, due;
+
+	if (w->target_rate <= 0)
+		return;
+
+	now = gettime();
+	if (w->pace_time == 0) {
+		w->pace_time = now;
+		w->pace_bytes = workload_bytes(w);
+		return;
+	}
+
+	due = w->pace_time + (workload_bytes(w) - w->pace_bytes) /
+			     w->target_rate;
+	if (now - due > PACE_MAX_BACKLOG)
+		w->pace_time += now - due - PACE_MAX_BACKLOG;
+
+	if (due - now > PACE_SPIN_TIME)
+		sleep_seconds(due - now - PACE_SPIN_TIME);
+	while (gettime() < due)
+		;
+}
+
+static uint64_t total_bytes(workload_t *workloads, int number_of_workloads)
+{
+	uint64_t bytes = 0;
+	int i;
+	for (i = 0; i < number_of_workloads; i++)
+		bytes += workload_bytes(&workloads[i]);
+	return bytes;
+}
+
+/*
+ * Wait until the combined rate of the workloads stops changing: the mean
+ * rate of the last WARMUP_PROBES / 2 short probes is within
+ * WARMUP_TOLERANCE percent of the mean of the probes before them. The
+ * caches, the cpufreq governor and the GPU driver need some time after the
+ * threads are started. Gives up after 'max_warmup_time' seconds.
+ */
+static double wait_for_warmup(workload_t *workloads, int number_of_workloads)
+{
+	double rates[WARMUP_PROBES], t0, t1, t2, older, newer;
+	uint64_t b1, b2;
+	int i, n = 0;
+
+	if (max_warmup_time <= 0)
+		return 0;
+
+	t0 = t1 = gettime();
+	b1 = total_bytes(workloads, number_of_workloads);
+	while (1) {
+		sleep_seconds(WARMUP_STEP);
+		t2 = gettime();
+		b2 = total_bytes(workloads, number_of_workloads);
+		rates[n++ % WARMUP_PROBES] = (b2 - b1) / (t2 - t1);
+		t1 = t2;
+		b1 = b2;
+
+		if (n >= WARMUP_PROBES) {
+			older = newer = 0;
+			for (i = 0; i < WARMUP_PROBES / 2; i++) {
+				older += rates[(n + i) % WARMUP_PROBES];
+				newer += rates[(n + i + WARMUP_PROBES / 2) %
+					       WARMUP_PROBES];
+			}
+			if (fabs(newer - older) <= (newer + older) / 2 *
+						   WARMUP_TOLERANCE / 100) {
+				printf("Warm-up: stable after %.2fs\n", t2 - t0);
+				return t2 - t0;
+			}
+		}
+		if (t2 - t0 >= max_warmup_time) {
+			printf("Warm-up: not stable after %.1fs, "
+			       "measuring anyway\n", t2 - t0);
+			return t2 - t0;
+		}
+	}
+}
+
+/*
+ * Sample the bandwidth of the running workloads every 'sample_interval'
+ * seconds until the 95% confidence interval of the mean of the combined
+ * bandwidth is within 'ci_target' percent (at least MIN_SAMPLES samples)
+ * or until 'max_duration' seconds have passed.
+ */
+static void measure_bandwidth(workload_t *workloads, int number_of_workloads,
+			      measurement_t *m)
+{
+	int i, n = 0, max_samples = max_duration / sample_interval + 0.5;
+	double t0, t1, t2, *totals, *samples, *column;
+	uint64_t *bytes = calloc(number_of_workloads, sizeof(uint64_t));
+	uint64_t *perf = NULL, *perf_bytes = NULL;
+	perf_snapshot_t *perf_start = NULL;
+
+	if (max_samples < MIN_SAMPLES)
+		max_samples = MIN_SAMPLES;
+	totals = calloc(max_samples, sizeof(double));
+	samples = calloc(max_samples * number_of_workloads, sizeof(double));
+	column = calloc(max_samples, sizeof(double));
+	m->workload_stats = calloc(number_of_workloads,
+				   sizeof(bandwidth_stats_t));
+	assert(bytes && totals && samples && column && m->workload_stats);
+
+	m->warmup_time = wait_for_warmup(workloads, number_of_workloads);
+	m->sample_interval = sample_interval;
+
+	if (timeseries_interval > 0)
+		timeseries_start(workloads, number_of_workloads,
+				 timeseries_interval);
+
+	if (use_perf_counters) {
+		perf_start = calloc(number_of_workloads,
+				    sizeof(perf_snapshot_t));
+		perf = calloc(number_of_workloads * PERF_EVENTS,
+			      sizeof(uint64_t));
+		perf_bytes = calloc(number_of_workloads, sizeof(uint64_t));
+		assert(perf_start && perf && perf_bytes);
+		for (i = 0; i < number_of_workloads; i++)
+			perf_counters_read(&workloads[i].perf, &perf_start[i]);
+	}
+
+	t0 = t1 = gettime();
+	for (i = 0; i < number_of_workloads; i++)
+		bytes[i] = workload_bytes(&workloads[i]);
+	if (perf_bytes)
+		memcpy(perf_bytes, bytes, number_of_workloads * sizeof(uint64_t));
+
+	/* Do the bandwidth measurements */
+	while (n < max_samples) {
+		printf(".");
+		fflush(stdout);
+		sleep_seconds(sample_interval);
+
+		t2 = gettime();
+		totals[n] = 0;
+		for (i = 0; i < number_of_workloads; i++) {
+			uint64_t b = workload_bytes(&workloads[i]);
+			double bw = (b - bytes[i]) / (t2 - t1) / 1000000.;
+			samples[n * number_of_workloads + i] = bw;
+			totals[n] += bw;
+			bytes[i] = b;
+		}
+		t1 = t2;
+		n++;
+
+		compute_stats(totals, n, &m->total);
+		if (n >= MIN_SAMPLES && relative_ci95(&m->total) <= ci_target)
+			break;
+		if (t2 - t0 >= max_duration)
+			break;
+	}
+	printf("\n");
+
+	if (use_perf_counters) {
+		perf_snapshot_t end;
+		for (i = 0; i < number_of_workloads; i++) {
+			perf_counters_read(&workloads[i].perf, &end);
+			perf_counters_delta(perf + i * PERF_EVENTS,
+					    &perf_start[i], &end);
+			perf_bytes[i] = bytes[i] - perf_bytes[i];
+		}
+		free(perf_start);
+	}
+
+	for (i = 0; i < number_of_workloads; i++) {
+		int j;
+		for (j = 0; j < n; j++)
+			column[j] = samples[j * number_of_workloads + i];
+		compute_stats(column, n, &m->workload_stats[i]);
+	}
+
+	if (timeseries_interval > 0)
+		timeseries_stop_and_print();
+
+	m->number_of_samples = n;
+	m->total_samples = totals;
+	m->workload_samples = samples;
+	m->workload_perf = perf;
+	m->workload_perf_bytes = perf_bytes;
+	free(bytes);
+	free(column);
+}
+
+static void print_bandwidth_report(workload_t *workloads,
+				   int number_of_workloads,
+				   bandwidth_stats_t *total,
+				   bandwidth_stats_t *per_workload)
+{
+	double limited = 0, unlimited = 0;
+	int i, number_of_unlimited = 0;
+
+	printf("Total combined memory bandwidth: %.1f MB/s\n", total->mean);
+	printf("    %d samples of %gs: median %.1f, min %.1f, max %.1f, "
+	       "stddev %.1f MB/s\n", total->n, sample_interval, total->median,
+	       total->min, total->max, total->stddev);
+	printf("    95%% confidence interval: %.1f +- %.1f MB/s (%.2f%%, "
+	       "target %.2f%%)\n", total->mean, total->ci95,
+	       relative_ci95(total), ci_target);
+
+	if (number_of_workloads < 2)
+		return;
+
+	printf("\n%-26s %9s %9s %9s %9s %8s %8s\n", "workload", "mean",
+	       "median", "min", "max", "stddev", "95% CI");
+	for (i = 0; i < number_of_workloads; i++) {
+		bandwidth_stats_t *st = &per_workload[i];
+		printf("%-26s %9.1f %9.1f %9.1f %9.1f %8.1f %8.1f\n",
+		       workloads[i].name, st->mean, st->median, st->min,
+		       st->max, st->stddev, st->ci95);
+	}
+
+	/* The capacity left for the full speed workloads under the load
+	   from the rate limited ones */
+	for (i = 0; i < number_of_workloads; i++) {
+		if (workloads[i].target_rate <= 0) {
+			unlimited += per_workload[i].mean;
+			number_of_unlimited++;
+			continue;
+		}
+		limited += per_workload[i].mean;
+		printf("%s: %.1f MB/s for the target of %.1f MB/s (%+.1f%%)\n",
+		       workloads[i].name, per_workload[i].mean,
+		       workloads[i].target_rate / 1000000.,
+		       (per_workload[i].mean * 1000000. /
+			workloads[i].target_rate - 1) * 100);
+	}
+	if (limited > 0 && number_of_unlimited)
+		printf("Bandwidth left for the full speed workloads under "
+		       "%.1f MB/s of load: %.1f MB/s\n", limited, unlimited);
+}
+
+static void print_perf_report(workload_t *workloads, int number_of_workloads,
+			      measurement_t *m)
+{
+	int i;
+
+	if (!m->workload_perf)
+		return;
+	printf("\nHardware counters of the workload threads:\n");
+	for (i = 0; i < number_of_workloads; i++) {
+		printf("%-26s ", workloads[i].name);
+		perf_counters_print(stdout, m->workload_perf + i * PERF_EVENTS,
+				    m->workload_perf_bytes[i]);
+	}
+}
+
+/*
+ * The '-j' mode. The non-CPU workloads run in a single thread all the time,
+ * while each CPU workload gets one more thread (pinned to the next cpu from
+ * the list) on every step. The report shows where the combined bandwidth
+ * stops growing, which is the saturation point of the memory controller.
+ */
+static void run_thread_scaling(workload_t *base, int number_of_base,
+			       int min_jobs, int max_jobs)
+{
+	workload_t *workloads;
+	measurement_t m;
+	double *totals, cpu_bw, first_cpu_bw = 0;
+	int i, j, jobs, n = 0, cpu_threads, saturation = 0;
+
+	workloads = alloc_workloads(number_of_base * max_jobs);
+	totals = calloc(max_jobs + 1, sizeof(double));
+	assert(totals);
+
+	for (i = 0; i < number_of_base; i++) {
+		if (base[i].thread_func == cpu_thread)
+			continue;
+		workloads[n] = base[i];
+		start_workload_thread(&workloads[n++]);
+	}
+
+	for (jobs = 1; jobs <= max_jobs; jobs++) {
+		for (i = 0; i < number_of_base; i++) {
+			if (base[i].thread_func != cpu_thread)
+				continue;
+			workloads[n] = base[i];
+			start_workload_thread(&workloads[n++]);
+		}
+		if (jobs < min_jobs)
+			continue;
+
+		measure_bandwidth(workloads, n, &m);
+		report_measurement(jobs, workloads, n, &m);
+		cpu_bw = 0;
+		cpu_threads = 0;
+		for (i = 0; i < n; i++) {
+			if (workloads[i].thread_func == cpu_thread) {
+				cpu_bw += m.workload_stats[i].mean;
+				cpu_threads++;
+			}
+		}
+		if (jobs == min_jobs)
+			first_cpu_bw = cpu_bw / jobs;
+
+		printf("-j %d: total %.1f +- %.1f MB/s", jobs, m.total.mean,
+		       m.total.ci95);
+		if (cpu_threads) {
+			printf(", cpu %.1f MB/s (%.1f MB/s per thread, "
+			       "efficiency %.0f%%)", cpu_bw, cpu_bw / cpu_threads,
+			       first_cpu_bw > 0 ?
+			       cpu_bw / jobs / first_cpu_bw * 100 : 0);
+		}
+		printf("\n");
+		for (i = 0; i < n; i++) {
+			printf("    %-26s", workloads[i].name);
+			if (workloads[i].cpu_index >= 0)
+				printf(" #%-3d", workloads[i].cpu_index);
+			else
+				printf("     ");
+			printf(" %10.1f MB/s\n", m.workload_stats[i].mean);
+		}
+		print_perf_report(workloads, n, &m);
+
+		totals[jobs] = m.total.mean;
+		if (!saturation && jobs > min_jobs &&
+		    m.total.mean < totals[jobs - 1] * 1.05)
+			saturation = jobs - 1;
+		free_measurement(&m);
+	}
+
+	if (min_jobs == max_jobs)
+		return;
+
+	printf("\nTotal combined memory bandwidth by the number of threads:\n");
+	for (j = min_jobs; j <= max_jobs; j++)
+		printf("    -j %-3d %10.1f MB/s\n", j, totals[j]);
+	if (saturation)
+		printf("The bandwidth saturates at -j %d (less than 5%% gain "
+		       "from one more thread)\n", saturation);
+	else
+		printf("The bandwidth has not saturated up to -j %d\n",
+		       max_jobs);
+}
+
+static int write_all(int fd, const void *data, size_t size)
+{
+	const char *p = data;
+	ssize_t ret;
+
+	while (size > 0) {
+		ret = write(fd, p, size);
+		if (ret <= 0)
+			return -1;
+		p += ret;
+		size -= ret;
+	}
+	return 0;
+}
+
+static int read_all(int fd, void *data, size_t size)
+{
+	char *p = data;
+	ssize_t ret;
+
+	while (size > 0) {
+		ret = read(fd, p, size);
+		if (ret <= 0)
+			return -1;
+		p += ret;
+		size -= ret;
+	}
+	return 0;
+}
+
+/*
+ * Pass the workloads and the measurement from the child to the parent:
+ * the structs first and then the contents of the arrays. The parent only
+ * uses the workload fields filled in for the reports, and fork() keeps
+ * the addresses, so the name pointers are valid there as well.
+ */
+static int write_measurement(int fd, workload_t *workloads, int n,
+			     measurement_t *m)
+{
+	int ns = m->number_of_samples;
+
+	if (write_all(fd, workloads, n * sizeof(workload_t)) < 0 ||
+	    write_all(fd, m, sizeof(*m)) < 0 ||
+	    write_all(fd, m->total_samples, ns * sizeof(double)) < 0 ||
+	    write_all(fd, m->workload_samples, ns * n * sizeof(double)) < 0 ||
+	    write_all(fd, m->workload_stats,
+		      n * sizeof(bandwidth_stats_t)) < 0)
+		return -1;
+	if (!m->workload_perf)
+		return 0;
+	if (write_all(fd, m->workload_perf,
+		      n * PERF_EVENTS * sizeof(uint64_t)) < 0 ||
+	    write_all(fd, m->workload_perf_bytes, n * sizeof(uint64_t)) < 0)
+		return -1;
+	return 0;
+}
+
+static int read_measurement(int fd, workload_t *workloads, int n,
+			    measurement_t *m)
+{
+	int ns, has_perf;
+
+	if (read_all(fd, workloads, n * sizeof(workload_t)) < 0 ||
+	    read_all(fd, m, sizeof(*m)) < 0) {
+		memset(m, 0, sizeof(*m));
+		return -1;
+	}
+	ns = m->number_of_samples;
+	has_perf = m->workload_perf != NULL;
+	m->total_samples = calloc(ns + 1, sizeof(double));
+	m->workload_samples = calloc(ns * n + 1, sizeof(double));
+	m->workload_stats = calloc(n, sizeof(bandwidth_stats_t));
+	m->workload_perf = has_perf ?
+			   calloc(n * PERF_EVENTS, sizeof(uint64_t)) : NULL;
+	m->workload_perf_bytes = has_perf ?
+				 calloc(n, sizeof(uint64_t)) : NULL;
+	assert(m->total_samples && m->workload_samples && m->workload_stats);
+	assert(!has_perf || (m->workload_perf && m->workload_perf_bytes));
+
+	if (read_all(fd, m->total_samples, ns * sizeof(double)) < 0 ||
+	    read_all(fd, m->workload_samples, ns * n * sizeof(double)) < 0 ||
+	    read_all(fd, m->workload_stats,
+		     n * sizeof(bandwidth_stats_t)) < 0)
+		return -1;
+	if (!has_perf)
+		return 0;
+	if (read_all(fd, m->workload_perf,
+		     n * PERF_EVENTS * sizeof(uint64_t)) < 0 ||
+	    read_all(fd, m->workload_perf_bytes, n * sizeof(uint64_t)) < 0)
+		return -1;
+	return 0;
+}
+
+/*
+ * Run a combination of the workloads in a child process and get the mean
+ * bandwidth of each of them. The process exit is the simplest way to stop
+ * the threads and to release the GPU and the framebuffer between the runs.
+ * The whole measurement is sent back to the parent, which adds it to the
+ * structured output.
+ */
+static int measure_combination(workload_t *base, const int *index, int n,
+			       double *bw)
+{
+	workload_t *workloads = alloc_workloads(n);
+	measurement_t m;
+	int fds[2], i, ok;
+	pid_t pid;
+
+	if (pipe(fds) < 0)
+		return -1;
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0) {
+		int fd = open("/dev/null", O_WRONLY);
+		if (fd >= 0)
+			dup2(fd, STDOUT_FILENO);
+		close(fds[0]);
+		for (i = 0; i < n; i++) {
+			workloads[i] = base[index[i]];
+			start_workload_thread(&workloads[i]);
+		}
+		measure_bandwidth(workloads, n, &m);
+		ok = write_measurement(fds[1], workloads, n, &m) == 0;
+		_exit(ok ? 0 : 1);
+	}
+	close(fds[1]);
+	ok = read_measurement(fds[0], workloads, n, &m) == 0;
+	close(fds[0]);
+	waitpid(pid, NULL, 0);
+	if (ok) {
+		for (i = 0; i < n; i++)
+			bw[i] = m.workload_stats[i].mean;
+		report_measurement(0, workloads, n, &m);
+	}
+	free_measurement(&m);
+	free(workloads);
+	return ok ? 0 : -1;
+}
+
+static void print_slowdown(double bw, double alone)
+{
+	if (alone > 0)
+		printf(" %11.1f%%", (1 - bw / alone) * 100);
+	else
+		printf(" %12s", "n/a");
+}
+
+/*
+ * The '--matrix' mode. Each workload is measured alone and then with every
+ * other one (and with every pair of the others for '--triples'), which
+ * shows which agents contend for the memory bandwidth. The slowdown is the
+ * bandwidth lost by a workload compared to running alone.
+ */
+static void run_interference_matrix(workload_t *workloads, int n,
+				    int triples)
+{
+	double *alone, *pair_bw, bw[3];
+	int i, j, k, index[3];
+
+	alone = calloc(n, sizeof(double));
+	pair_bw = calloc(n * n, sizeof(double));
+	assert(alone && pair_bw);
+
+	for (i = 0; i < n; i++) {
+		printf("Measuring %s alone\n", workloads[i].name);
+		if (measure_combination(workloads, &i, 1, &alone[i]) < 0)
+			printf("    failed\n");
+	}
+	for (i = 0; i < n; i++) {
+		for (j = i + 1; j < n; j++) {
+			printf("Measuring %s + %s\n", workloads[i].name,
+			       workloads[j].name);
+			index[0] = i;
+			index[1] = j;
+			if (measure_combination(workloads, index, 2, bw) < 0) {
+				printf("    failed\n");
+				continue;
+			}
+			/* pair_bw[i * n + j] is i running together with j */
+			pair_bw[i * n + j] = bw[0];
+			pair_bw[j * n + i] = bw[1];
+		}
+	}
+
+	printf("\n%-26s %12s\n", "workload", "alone MB/s");
+	for (i = 0; i < n; i++)
+		printf("%-26s %12.1f\n", workloads[i].name, alone[i]);
+
+	printf("\nSlowdown of each workload (row) when running together with "
+	       "another one (column):\n");
+	printf("%-26s", "");
+	for (j = 0; j < n; j++)
+		printf(" %12.12s", workloads[j].name);
+	printf("\n");
+	for (i = 0; i < n; i++) {
+		printf("%-26s", workloads[i].name);
+		for (j = 0; j < n; j++) {
+			if (i == j)
+				printf(" %12s", "-");
+			else
+				print_slowdown(pair_bw[i * n + j], alone[i]);
+		}
+		printf("\n");
+	}
+
+	printf("\nCombined bandwidth of each pair (MB/s):\n");
+	printf("%-26s", "");
+	for (j = 0; j < n; j++)
+		printf(" %12.12s", workloads[j].name);
+	printf("\n");
+	for (i = 0; i < n; i++) {
+		printf("%-26s", workloads[i].name);
+		for (j = 0; j < n; j++) {
+			if (i == j)
+				printf(" %12s", "-");
+			else
+				printf(" %12.1f", pair_bw[i * n + j] +
+						  pair_bw[j * n + i]);
+		}
+		printf("\n");
+	}
+
+	if (!triples || n < 3)
+		return;
+
+	printf("\nSlowdown of each workload of the triples (in the same "
+	       "order):\n");
+	for (i = 0; i < n; i++) {
+		for (j = i + 1; j < n; j++) {
+			for (k = j + 1; k < n; k++) {
+				index[0] = i;
+				index[1] = j;
+				index[2] = k;
+				if (measure_combination(workloads, index, 3,
+							bw) < 0) {
+					printf("%s + %s + %s: failed\n",
+					       workloads[i].name,
+					       workloads[j].name,
+					       workloads[k].name);
+					continue;
+				}
+				printf("%s + %s + %s (total %.1f MB/s):\n",
+				       workloads[i].name, workloads[j].name,
+				       workloads[k].name,
+				       bw[0] + bw[1] + bw[2]);
+				printf("   ");
+				print_slowdown(bw[0], alone[i]);
+				print_slowdown(bw[1], alone[j]);
+				print_slowdown(bw[2], alone[k]);
+				printf("\n");
+			}
+		}
+	}
+}
+
+/*
+ * The '--fb-check' mode. The scanout bandwidth estimated by the fb_scanout
+ * workload is cross-checked against the drop of the bandwidth of the other
+ * workloads when the screen is unblanked. The workloads should saturate the
+ * memory controller, otherwise the drop is smaller than the scanout traffic.
+ * The blanked and unblanked periods alternate to cancel out any drift.
+ */
+#define FB_CHECK_ROUNDS 5
+#define FB_CHECK_SETTLE 0.2
+
+static double measure_total(workload_t *workloads, int n, double seconds)
+{
+	uint64_t b1, b2;
+	double t1, t2;
+
+	b1 = total_bytes(workloads, n);
+	t1 = gettime();
+	sleep_seconds(seconds);
+	b2 = total_bytes(workloads, n);
+	t2 = gettime();
+	return (b2 - b1) / (t2 - t1) / 1000000.;
+}
+
+static int run_fb_check(workload_t *workloads, int n)
+{
+	double blanked = 0, unblanked = 0, drop, model;
+	fb_scanout_t fb;
+	int i;
+
+	if (fb_scanout_open(&fb) < 0) {
+		printf("Can't get the framebuffer mode from /dev/fb0\n");
+		return -1;
+	}
+	model = fb.bandwidth / 1000000.;
+	printf("Framebuffer %s, estimated scanout bandwidth %.1f MB/s\n",
+	       fb.mode, model);
+
+	for (i = 0; i < n; i++)
+		start_workload_thread(&workloads[i]);
+	wait_for_warmup(workloads, n);
+
+	for (i = 0; i < FB_CHECK_ROUNDS; i++) {
+		double bw;
+		if (fb_scanout_blank(&fb, 1) < 0)
+			break;
+		sleep_seconds(FB_CHECK_SETTLE);
+		bw = measure_total(workloads, n, sample_interval);
+		printf("blanked:   %.1f MB/s\n", bw);
+		blanked += bw;
+		fb_scanout_blank(&fb, 0);
+		sleep_seconds(FB_CHECK_SETTLE);
+		bw = measure_total(workloads, n, sample_interval);
+		printf("unblanked: %.1f MB/s\n", bw);
+		unblanked += bw;
+	}
+	fb_scanout_blank(&fb, 0);
+	close(fb.fd);
+	if (i < FB_CHECK_ROUNDS) {
+		printf("Can't blank the screen\n");
+		return -1;
+	}
+
+	blanked /= FB_CHECK_ROUNDS;
+	unblanked /= FB_CHECK_ROUNDS;
+	drop = blanked - unblanked;
+	printf("Bandwidth drop with the screen unblanked: %.1f MB/s "
+	       "(%.0f%% of the estimate of %.1f MB/s)\n", drop,
+	       drop * 100 / model, model);
+	return 0;
+}
+
+/* "800M" is 800 MB/s, the K, M and G suffixes are decimal like the reports */
+static double parse_rate(const char *str)
+{
+	char *end;
+	double rate = strtod(str, &end);
+	if (*end == 'K' || *end == 'k')
+		rate *= 1e3;
+	else if (*end == 'M' || *end == 'm')
+		rate *= 1e6;
+	else if (*end == 'G' || *end == 'g')
+		rate *= 1e9;
+	else if (*end)
+		return -1;
+	if (*end && end[1])
+		return -1;
+	return rate;
+}
+
+static char *online_cpus(void)
+{
+	static char buf[256];
+	FILE *f = fopen("/sys/devices/system/cpu/online", "r");
+	if (!f)
+		return NULL;
+	if (!fgets(buf, sizeof(buf), f)) {
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+	buf[strcspn(buf, "\n")] = '\0';
+	return buf;
+}
+
 int main(int argc, char *argv[])
 {
 	int i, j, number_of_workloads = 0;
 	workload_t *workloads;
-	double t1, t2, bytes1, bytes2;
-	double s1, s2;
-	int n;
+	measurement_t m;
+	const char *json_filename = NULL, *csv_filename = NULL;
+	char buf[256];
+	int first_workload_arg = 1, sweep = 0, hugepages = 0;
+	int min_jobs = 0, max_jobs = 0, matrix = 0, triples = 0;
+	int fb_check = 0, latency = 0, latency_cpu = -1;
 	
-	if (argc < 2)
+	init_available_workloads();
+
+	while (first_workload_arg < argc && argv[first_workload_arg][0] == '-') {
+		const char *opt = argv[first_workload_arg++];
+		if (strcmp(opt, "--list") == 0)
+			list_cpu_kernels_and_exit();
+		else if (strcmp(opt, "--sweep") == 0)
+			sweep = 1;
+		else if (strcmp(opt, "--hugepages") == 0)
+			hugepages = 1;
+		else if (strcmp(opt, "--matrix") == 0)
+			matrix = 1;
+		else if (strcmp(opt, "--triples") == 0)
+			matrix = triples = 1;
+		else if (strcmp(opt, "--fb-check") == 0)
+			fb_check = 1;
+		else if (strcmp(opt, "--perf") == 0)
+			use_perf_counters = 1;
+		else if (strcmp(opt, "--latency") == 0)
+			latency = 1;
+		else if (strcmp(opt, "--latency-cpu") == 0 &&
+			 first_workload_arg < argc) {
+			char *end;
+			opt = argv[first_workload_arg++];
+			latency_cpu = strtol(opt, &end, 10);
+			if (*end || end == opt || latency_cpu < 0)
+				show_help_and_exit();
+		}
+		else if (strcmp(opt, "-j") == 0 && first_workload_arg < argc) {
+			char *end;
+			opt = argv[first_workload_arg++];
+			min_jobs = max_jobs = strtol(opt, &end, 10);
+			if (strncmp(end, "..", 2) == 0)
+				max_jobs = strtol(end + 2, &end, 10);
+			if (*end || min_jobs < 1 || max_jobs < min_jobs)
+				show_help_and_exit();
+		}
+		else if (strcmp(opt, "--timeseries") == 0 &&
+			 first_workload_arg < argc) {
+			timeseries_interval = atof(argv[first_workload_arg++]) /
+					      1000;
+			if (timeseries_interval < 0.01)
+				show_help_and_exit();
+		}
+		else if (strcmp(opt, "--warmup") == 0 && first_workload_arg < argc)
+			max_warmup_time = atof(argv[first_workload_arg++]);
+		else if (strcmp(opt, "--interval") == 0 &&
+			 first_workload_arg < argc) {
+			sample_interval = atof(argv[first_workload_arg++]);
+			if (sample_interval < 0.01)
+				show_help_and_exit();
+		}
+		else if (strcmp(opt, "--ci") == 0 && first_workload_arg < argc)
+			ci_target = atof(argv[first_workload_arg++]);
+		else if (strcmp(opt, "--max-time") == 0 &&
+			 first_workload_arg < argc)
+			max_duration = atof(argv[first_workload_arg++]);
+		else if (strcmp(opt, "--json") == 0 && first_workload_arg < argc)
+			json_filename = argv[first_workload_arg++];
+		else if (strcmp(opt, "--csv") == 0 && first_workload_arg < argc)
+			csv_filename = argv[first_workload_arg++];
+		else if (strcmp(opt, "-a") == 0 && first_workload_arg < argc) {
+			cpulist = argv[first_workload_arg++];
+			if (cpu_list_count(cpulist) <= 0)
+				show_help_and_exit();
+		}
+		else
+			show_help_and_exit();
+	}
+
+	if (first_workload_arg >= argc && !latency)
 		show_help_and_exit();
 
-	workloads = calloc(argc - 1, sizeof(workload_t));
-	assert(workloads);
+	/* These modes print their own results and write no measurements */
+	if ((json_filename || csv_filename) && (sweep || latency || fb_check)) {
+		printf("The --json and --csv output is not available with "
+		       "--sweep, --latency and --fb-check\n");
+		return 1;
+	}
+
+	workloads = alloc_workloads(argc - first_workload_arg);
 
 	/* Prepare the workloads array */
-	for (i = 1; i < argc; i++) {
+	for (i = first_workload_arg; i < argc; i++) {
 		int workload_found = 0;
-		for (j = 0; j < ARRAY_SIZE(workloads_list); j++) {
-			if (strcmp(argv[i], workloads_list[j].name) == 0) {
-				workloads[number_of_workloads++] = workloads_list[j];
+		char *rate = strchr(argv[i], '@');
+		size_t len = rate ? rate - argv[i] : strlen(argv[i]);
+		for (j = 0; j < number_of_available_workloads; j++) {
+			if (strncmp(argv[i], available_workloads[j].name, len) == 0 &&
+			    available_workloads[j].name[len] == '\0') {
+				workloads[number_of_workloads++] = available_workloads[j];
 				workload_found = 1;
+				break;
 			}
 		}
+		if (!workload_found && strncmp(argv[i], "gpu_tex", 7) == 0) {
+			workload_t *w = &workloads[number_of_workloads];
+			w->name = strndup(argv[i], len);
+			w->thread_func = gpu_texture_thread;
+			workload_found = gpu_texture_name_valid(w->name);
+			if (workload_found)
+				number_of_workloads++;
+		}
 		if (!workload_found)
 			show_help_and_exit();
+		if (rate) {
+			workload_t *w = &workloads[number_of_workloads - 1];
+			w->target_rate = parse_rate(rate + 1);
+			if (w->target_rate <= 0 || w->thread_func == fb_blank_thread ||
+			    w->thread_func == fb_scanout_thread) {
+				printf("Can't run '%s' at the rate '%s'\n", w->name,
+				       rate + 1);
+				return 1;
+			}
+		}
 	}
 
-	/* Start the workloads threads */
-	for (i = 0; i < number_of_workloads; i++) {
-		printf("Starting '%s' thread\n", workloads[i].name);
-		pthread_create(&workloads[i].thread_id, NULL, workloads[i].thread_func, &workloads[i]);
+	if (sweep) {
+		for (i = 0; i < number_of_workloads; i++) {
+			if (workloads[i].thread_func != cpu_thread) {
+				printf("Only the CPU workloads can be swept, not '%s'\n",
+				       workloads[i].name);
+				return 1;
+			}
+		}
+		for (i = 0; i < number_of_workloads; i++)
+			cpu_kernel_sweep(workloads[i].extra_data, hugepages);
+		return 0;
 	}
 
-	/* Warm-up */
-	sleep(1);
-
-	s1 = s2 = 0;
-	n = 0;
-
-	/* Do the bandwidth measurements (infinite loop) */
-	while (1) {
-		/* Save time and the bandwidth counters */
-		pthread_mutex_lock(&bandwidth_counters_mutex);
-		t1 = gettime();
-		bytes1 = 0;
-		for (i = 0; i < number_of_workloads; i++) {
-			bytes1 += workloads[i].bytes_counter;
+	if (use_perf_counters) {
+		perf_counters_t pc;
+		perf_counters_init(&pc);
+		if (!perf_counters_open(&pc)) {
+			printf("Hardware performance counters are not "
+			       "available: %s\n", strerror(errno));
+			use_perf_counters = 0;
 		}
-		pthread_mutex_unlock(&bandwidth_counters_mutex);
+		perf_counters_close(&pc);
+	}
 
-		printf(".");
-		fflush(stdout);
-		sleep(2);
+	if (latency) {
+		for (i = 0; i < number_of_workloads; i++)
+			start_workload_thread(&workloads[i]);
+		if (number_of_workloads)
+			wait_for_warmup(workloads, number_of_workloads);
+		if (latency_cpu < 0 && cpulist) {
+			latency_cpu = cpu_outside_list(cpulist);
+			if (latency_cpu < 0)
+				printf("No cpu is left outside of the -a list "
+				       "for the latency measurement\n");
+		}
+		return latency_sweep(workloads, number_of_workloads,
+				     latency_cpu) < 0;
+	}
 
-		pthread_mutex_lock(&bandwidth_counters_mutex);
-		t2 = gettime();
-		bytes2 = 0;
+	if (fb_check) {
 		for (i = 0; i < number_of_workloads; i++) {
-			bytes2 += workloads[i].bytes_counter;
+			if (workloads[i].thread_func == fb_blank_thread ||
+			    workloads[i].thread_func == fb_scanout_thread) {
+				printf("The --fb-check mode controls the screen "
+				       "itself, can't run '%s'\n",
+				       workloads[i].name);
+				return 1;
+			}
 		}
-		pthread_mutex_unlock(&bandwidth_counters_mutex);
+		return run_fb_check(workloads, number_of_workloads) < 0;
+	}
 
-		double bw = (bytes2 - bytes1) / (t2 - t1) / 1000000.;
+	if (max_jobs && !cpulist)
+		cpulist = online_cpus();
 
-		n++;
-		s1 += bw;
-		s2 += bw * bw;
-		
-		if (n >= 3) {
-			double stddev = sqrt((n * s2 - s1 * s1) / (n * (n - 1)));
-			double sem = stddev / sqrt(n);
-
-			if (sem < (s1 / n) * 0.002)
-				break;
-		}
-
-		if (n >= 15)
+	if (report_open(json_filename, csv_filename) < 0)
+		return 1;
+	buf[0] = '\0';
+	for (i = first_workload_arg; i < argc; i++) {
+		if (strlen(buf) + strlen(argv[i]) + 2 > sizeof(buf))
 			break;
+		if (buf[0])
+			strcat(buf, " ");
+		strcat(buf, argv[i]);
 	}
+	report_option("workloads", buf);
+	snprintf(buf, sizeof(buf), "%g", max_warmup_time);
+	report_option("warmup", buf);
+	snprintf(buf, sizeof(buf), "%g", sample_interval);
+	report_option("interval", buf);
+	snprintf(buf, sizeof(buf), "%g", ci_target);
+	report_option("ci", buf);
+	snprintf(buf, sizeof(buf), "%g", max_duration);
+	report_option("max_time", buf);
+	if (cpulist)
+		report_option("cpulist", cpulist);
+	if (use_perf_counters)
+		report_option("perf", "yes");
 
-	printf("\n");
-	printf("Total combined memory bandwidth: %.1f MB/s\n", (s1 / n));
+	if (max_jobs) {
+		run_thread_scaling(workloads, number_of_workloads,
+				   min_jobs, max_jobs);
+		report_close();
+		return 0;
+	}
+
+	if (matrix) {
+		run_interference_matrix(workloads, number_of_workloads,
+					triples);
+		report_close();
+		return 0;
+	}
+
+	/* Start the workloads threads */
+	for (i = 0; i < number_of_workloads; i++)
+		start_workload_thread(&workloads[i]);
+
+	measure_bandwidth(workloads, number_of_workloads, &m);
+	print_bandwidth_report(workloads, number_of_workloads, &m.total,
+			       m.workload_stats);
+	print_perf_report(workloads, number_of_workloads, &m);
+	for (i = 0; i < number_of_workloads; i++) {
+		if (workloads[i].thread_func == gpu_write_thread ||
+		    workloads[i].thread_func == gpu_copy_thread ||
+		    workloads[i].thread_func == gpu_texture_thread) {
+			printf("\n");
+			gpu_print_report(&workloads[i]);
+		}
+	}
+	report_measurement(0, workloads, number_of_workloads, &m);
+	report_close();
 
 	return 0;
 }
@@ -24,24 +24,91 @@
 #ifndef LIMA_MEMSPEED_H
 #define LIMA_MEMSPEED_H
 
+#include <stdint.h>
 #include <pthread.h>
+#include "perf_counters.h"
 
-extern pthread_mutex_t bandwidth_counters_mutex;
+#define CACHE_LINE_SIZE 64
 
 double gettime(void);
 
 typedef struct workload_t
 {
+	/*
+	 * The number of bytes transferred so far. There is a single writer
+	 * thread per workload, so no locking is needed: the workload thread
+	 * itself, or limare's notification thread (gpu_frame_done) for the
+	 * GPU workloads. It has a cache line of its own, so the threads do
+	 * not bounce cache lines between cpus.
+	 */
+	uint64_t bytes_counter __attribute__((aligned(CACHE_LINE_SIZE)));
+	/* The number of frames rendered by the GPU workloads, the same rules */
+	uint64_t frames_counter;
+	char counters_padding[CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+
 	const char *name;
 	const char *description;
 
-	double bytes_counter;
-
 	void *(*thread_func)(void *);
 	pthread_t thread_id;
 
 	void *extra_data;
-	int size_multiplier;
+
+	/* Pin the thread to the cpu_index-th cpu from cpulist (if not NULL) */
+	const char *cpulist;
+	int cpu_index;
+
+	/* Filled in by the thread for the reports: the cpu it is pinned to
+	   (or -1), the size of its buffer and the framebuffer mode */
+	int cpu;
+	int buffer_size;
+	char mode[64];
+
+	/* The target rate ("name@rate") in bytes per second, 0 for running
+	   at full speed, and the state of the pacing (workload_pace) */
+	double target_rate;
+	double pace_time;
+	uint64_t pace_bytes;
+
+	/* The hardware counters of the thread ('--perf'), set up by the
+	   thread itself before it sets perf_ready */
+	perf_counters_t perf;
+	int perf_ready;
 } workload_t;
 
+/* Sleep (or spin for the short waits) until the workload is no longer
+   ahead of its target rate. Does nothing for the full speed workloads. */
+void workload_pace(workload_t *w);
+
+/* Arrays of workloads need CACHE_LINE_SIZE alignment (not just calloc) */
+workload_t *alloc_workloads(int n);
+
+static inline uint64_t workload_bytes(workload_t *w)
+{
+	return __atomic_load_n(&w->bytes_counter, __ATOMIC_RELAXED);
+}
+
+static inline void workload_set_bytes(workload_t *w, uint64_t bytes)
+{
+	__atomic_store_n(&w->bytes_counter, bytes, __ATOMIC_RELAXED);
+}
+
+/* Only to be called by the single writer thread of the workload */
+static inline void workload_add_bytes(workload_t *w, uint64_t bytes)
+{
+	workload_set_bytes(w, w->bytes_counter + bytes);
+}
+
+static inline uint64_t workload_frames(workload_t *w)
+{
+	return __atomic_load_n(&w->frames_counter, __ATOMIC_RELAXED);
+}
+
+/* Only to be called by the single writer thread of the workload */
+static inline void workload_add_frame(workload_t *w)
+{
+	__atomic_store_n(&w->frames_counter, w->frames_counter + 1,
+			 __ATOMIC_RELAXED);
+}
+
 #endif
@@ -30,6 +30,7 @@
 #include <fcntl.h>
 #include <linux/fb.h>
 #include "load_mali_kernel_module.h"
+#include "cpu_placement.h"
 
 int textured_cube_main(void);
 int memtester_main(int argc, char *argv[]);
@@ -53,6 +54,12 @@ void *fb_unblank_thread(void *data)
 
 static void *lima_thread(void *threadid)
 {
+	const char *cpulist = getenv("LIMA_MEMTESTER_GPU_CPUS");
+
+	/* The GPU driver thread competes with memtester for the cpu time */
+	if (cpulist && pin_current_thread(cpulist, -1) == 0)
+		printf("lima thread pinned to cpus %s\n", cpulist);
+
 	textured_cube_main();
 	/* If we reach here, something bad has happened */
 	abort();
@@ -162,6 +162,12 @@ limare_notification_thread(void *arg)
 				       wait.data.pp_job_finished.user_job_ptr,
 				       status);
 
+			if (state->pp_job_done_hook)
+				state->pp_job_done_hook(state,
+					wait.data.pp_job_finished.user_job_ptr &
+					~0xC0000000,
+					status == _MALI_UK_JOB_STATUS_END_SUCCESS);
+
 			limare_pp_job_done(wait.data.pp_job_finished.user_job_ptr);
 		} else if (wait.code.type == _MALI_NOTIFICATION_GP_FINISHED) {
 			_mali_uk_job_status status =
@@ -192,7 +198,7 @@ limare_gp_job_bench_start(struct timespec *start)
 }
 
 void
-limare_gp_job_bench_stop(struct timespec *start)
+limare_gp_job_bench_stop(struct limare_state *state, struct timespec *start)
 {
 	struct timespec new = { 0 };
 	long long total;
@@ -207,6 +213,7 @@ limare_gp_job_bench_stop(struct timespec *start)
 
 	pthread_mutex_lock(&gp_job_time_mutex);
 	gp_job_time += total;
+	state->gp_job_time += total;
 	pthread_mutex_unlock(&gp_job_time_mutex);
 }
 
@@ -223,7 +230,7 @@ limare_pp_job_bench_start(struct timespec *start)
 }
 
 void
-limare_pp_job_bench_stop(struct timespec *start)
+limare_pp_job_bench_stop(struct limare_state *state, struct timespec *start)
 {
 	struct timespec new = { 0 };
 	long long total;
@@ -238,6 +245,23 @@ limare_pp_job_bench_stop(struct timespec *start)
 
 	pthread_mutex_lock(&pp_job_time_mutex);
 	pp_job_time += total;
+	state->pp_job_time += total;
+	pthread_mutex_unlock(&pp_job_time_mutex);
+}
+
+/*
+ * Time spent in the GP and PP jobs of this state so far, in microseconds.
+ */
+void
+limare_job_bench_times(struct limare_state *state, long long *gp_usec,
+		       long long *pp_usec)
+{
+	pthread_mutex_lock(&gp_job_time_mutex);
+	*gp_usec = state->gp_job_time;
+	pthread_mutex_unlock(&gp_job_time_mutex);
+
+	pthread_mutex_lock(&pp_job_time_mutex);
+	*pp_usec = state->pp_job_time;
 	pthread_mutex_unlock(&pp_job_time_mutex);
 }
 
@@ -519,7 +543,7 @@ limare_render_sequence(struct limare_state *state, struct limare_frame *frame)
 
 	limare_gp_job_wait(frame);
 
-	limare_gp_job_bench_stop(&start);
+	limare_gp_job_bench_stop(state, &start);
 
 	/*
 	 * Now we can work on the pp.
@@ -530,7 +554,7 @@ limare_render_sequence(struct limare_state *state, struct limare_frame *frame)
 
 	limare_pp_job_wait(frame);
 
-	limare_pp_job_bench_stop(&start);
+	limare_pp_job_bench_stop(state, &start);
 
         /* wait for display sync, and flip the current fb. */
 	limare_fb_flip(state, frame);
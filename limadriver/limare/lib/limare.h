@@ -213,6 +213,19 @@ struct limare_state {
 	int indices_buffer_handles;
 
 	struct limare_fb *fb;
+
+	/*
+	 * Called from the notification thread when the PP job of a frame
+	 * has finished, with the id of the frame and whether the job was
+	 * successful. hook_data is for the user of the hook.
+	 */
+	void (*pp_job_done_hook)(struct limare_state *state,
+				 unsigned int frame_id, int success);
+	void *hook_data;
+
+	/* GP and PP job times of this state (limare_job_bench_times) */
+	long long gp_job_time;
+	long long pp_job_time;
 };
 
 /*
@@ -289,6 +302,10 @@ void limare_buffer_size(struct limare_state *state, int *width, int *height);
 
 void limare_finish(struct limare_state *state);
 
+/* from jobs.c */
+void limare_job_bench_times(struct limare_state *state, long long *gp_usec,
+			    long long *pp_usec);
+
 int limare_enable(struct limare_state *state, int parameter);
 int limare_disable(struct limare_state *state, int parameter);
 int limare_depth_func(struct limare_state *state, int value);
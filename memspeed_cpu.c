@@ -0,0 +1,704 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The CPU memory bandwidth workloads. All the kernels for the architecture
+ * are built in, but only the ones supported by the cpu are offered at
+ * runtime (for example, the NEON kernels are not offered on an ARM cpu
+ * without NEON and AVX2 needs to be checked on x86).
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <sched.h>
+
+#if defined(__arm__)
+#include <sys/auxv.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "lima-memspeed.h"
+#include "memspeed_cpu.h"
+#include "arm-neon.h"
+#include "cpu_placement.h"
+
+#define BUFFER_SIZE (32 * 1024 * 1024)
+
+/* The counter is updated after each chunk for the fine grained sampling */
+#define CHUNK_SIZE  (1024 * 1024)
+/* Smaller chunks for the rate limited workloads, for smoother pacing */
+#define PACED_CHUNK_SIZE (64 * 1024)
+
+/* The result of the read kernels, so that the reads are not optimized out */
+static volatile int64_t read_sink;
+
+/******************************************************************************/
+
+static void c_write(int64_t *dst, int64_t *src, int size)
+{
+	int64_t *end = dst + size / sizeof(int64_t);
+	while (dst < end) {
+		dst[0] = dst[1] = dst[2] = dst[3] = 0xCCCCCCCCCCCCCCCCLL;
+		dst += 4;
+	}
+}
+
+static void c_read(int64_t *dst, int64_t *src, int size)
+{
+	int64_t *end = src + size / sizeof(int64_t);
+	int64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	while (src < end) {
+		s0 += src[0];
+		s1 += src[1];
+		s2 += src[2];
+		s3 += src[3];
+		src += 4;
+	}
+	read_sink = s0 + s1 + s2 + s3;
+}
+
+static void c_copy(int64_t *dst, int64_t *src, int size)
+{
+	int64_t *end = src + size / sizeof(int64_t);
+	while (src < end) {
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		dst[3] = src[3];
+		dst += 4;
+		src += 4;
+	}
+}
+
+/******************************************************************************/
+
+/*
+ * The STREAM kernels (copy, scale, add and triad on doubles) and the
+ * integer kernels with 1, 2 or 3 reads per write, all over separate
+ * arrays. The GCC vector extensions make them use NEON, ASIMD or SSE2
+ * where available (ARMv7 NEON has no double precision, so the STREAM
+ * kernels use VFP there).
+ */
+
+typedef double v2df __attribute__((vector_size(16)));
+typedef int64_t v2di __attribute__((vector_size(16)));
+
+#define STREAM_SCALAR 3.0
+
+static void stream_copy(int64_t **arrays, int size)
+{
+	v2df *c = (v2df *)arrays[0], *a = (v2df *)arrays[1];
+	int i;
+	for (i = 0; i < size / sizeof(v2df); i++)
+		c[i] = a[i];
+}
+
+static void stream_scale(int64_t **arrays, int size)
+{
+	v2df *b = (v2df *)arrays[0], *c = (v2df *)arrays[1];
+	v2df scalar = { STREAM_SCALAR, STREAM_SCALAR };
+	int i;
+	for (i = 0; i < size / sizeof(v2df); i++)
+		b[i] = scalar * c[i];
+}
+
+static void stream_add(int64_t **arrays, int size)
+{
+	v2df *c = (v2df *)arrays[0], *a = (v2df *)arrays[1];
+	v2df *b = (v2df *)arrays[2];
+	int i;
+	for (i = 0; i < size / sizeof(v2df); i++)
+		c[i] = a[i] + b[i];
+}
+
+static void stream_triad(int64_t **arrays, int size)
+{
+	v2df *a = (v2df *)arrays[0], *b = (v2df *)arrays[1];
+	v2df *c = (v2df *)arrays[2];
+	v2df scalar = { STREAM_SCALAR, STREAM_SCALAR };
+	int i;
+	for (i = 0; i < size / sizeof(v2df); i++)
+		a[i] = b[i] + scalar * c[i];
+}
+
+static void mix_r1w1(int64_t **arrays, int size)
+{
+	v2di *d = (v2di *)arrays[0], *a = (v2di *)arrays[1];
+	v2di k = { 0x5555555555555555LL, 0x5555555555555555LL };
+	int i;
+	for (i = 0; i < size / sizeof(v2di); i++)
+		d[i] = a[i] ^ k;
+}
+
+static void mix_r2w1(int64_t **arrays, int size)
+{
+	v2di *d = (v2di *)arrays[0], *a = (v2di *)arrays[1];
+	v2di *b = (v2di *)arrays[2];
+	int i;
+	for (i = 0; i < size / sizeof(v2di); i++)
+		d[i] = a[i] + b[i];
+}
+
+static void mix_r3w1(int64_t **arrays, int size)
+{
+	v2di *d = (v2di *)arrays[0], *a = (v2di *)arrays[1];
+	v2di *b = (v2di *)arrays[2], *c = (v2di *)arrays[3];
+	int i;
+	for (i = 0; i < size / sizeof(v2di); i++)
+		d[i] = a[i] + b[i] + c[i];
+}
+
+/******************************************************************************/
+
+#ifdef __arm__
+
+#define HWCAP_ARM_VFP  (1 << 6)
+#define HWCAP_ARM_EDSP (1 << 7)
+#define HWCAP_ARM_NEON (1 << 12)
+
+static int have_neon(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_ARM_NEON) != 0;
+}
+
+static int have_vfp(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_ARM_VFP) != 0;
+}
+
+/* The "enhanced DSP" extension is what makes an ARMv5TE (PLD and STRD) */
+static int have_armv5te(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_ARM_EDSP) != 0;
+}
+
+static int have_armv4(void)
+{
+	return 1;
+}
+
+#define ARM_ASM_KERNEL_ENTRY(function, wname, feat, rd, wr, desc) \
+	{ \
+		.name = wname, \
+		.description = desc, \
+		.func = function, \
+		.supported = have_##feat, \
+		.feature = #feat, \
+		.read_multiplier = rd, \
+		.write_multiplier = wr, \
+	},
+
+/* The read2 routines get the two arrays and twice the size of each one */
+#define ARM_ASM_READ2_WRAPPER(function, wname, feat, rd, wr, desc) \
+	static void function##_arrays(int64_t **arrays, int size) \
+	{ \
+		function(arrays[1], arrays[0], 2 * size); \
+	}
+
+ARM_ASM_READ2_KERNELS(ARM_ASM_READ2_WRAPPER)
+
+#define ARM_ASM_READ2_ENTRY(function, wname, feat, rd, wr, desc) \
+	{ \
+		.name = wname, \
+		.description = desc, \
+		.arrays_func = function##_arrays, \
+		.arrays = 2, \
+		.supported = have_##feat, \
+		.feature = #feat, \
+		.read_multiplier = rd, \
+		.write_multiplier = wr, \
+	},
+
+#endif
+
+/******************************************************************************/
+
+#ifdef __aarch64__
+
+/* ASIMD is a mandatory part of ARMv8-A, so no runtime checks are needed */
+
+static void asimd_write(int64_t *dst, int64_t *src, int size)
+{
+	uint32x4_t v = vdupq_n_u32(0xCCCCCCCC);
+	uint32_t *p = (uint32_t *)dst, *end = p + size / sizeof(uint32_t);
+	while (p < end) {
+		vst1q_u32(p, v);
+		vst1q_u32(p + 4, v);
+		vst1q_u32(p + 8, v);
+		vst1q_u32(p + 12, v);
+		p += 16;
+	}
+}
+
+static void asimd_read(int64_t *dst, int64_t *src, int size)
+{
+	uint32x4_t s0 = vdupq_n_u32(0), s1 = s0, s2 = s0, s3 = s0;
+	uint32_t *p = (uint32_t *)src, *end = p + size / sizeof(uint32_t);
+	while (p < end) {
+		s0 = vaddq_u32(s0, vld1q_u32(p));
+		s1 = vaddq_u32(s1, vld1q_u32(p + 4));
+		s2 = vaddq_u32(s2, vld1q_u32(p + 8));
+		s3 = vaddq_u32(s3, vld1q_u32(p + 12));
+		p += 16;
+	}
+	read_sink = vaddvq_u32(vaddq_u32(vaddq_u32(s0, s1), vaddq_u32(s2, s3)));
+}
+
+static void asimd_copy(int64_t *dst, int64_t *src, int size)
+{
+	uint32_t *d = (uint32_t *)dst;
+	uint32_t *s = (uint32_t *)src, *end = s + size / sizeof(uint32_t);
+	while (s < end) {
+		uint32x4_t v0 = vld1q_u32(s), v1 = vld1q_u32(s + 4);
+		uint32x4_t v2 = vld1q_u32(s + 8), v3 = vld1q_u32(s + 12);
+		vst1q_u32(d, v0);
+		vst1q_u32(d + 4, v1);
+		vst1q_u32(d + 8, v2);
+		vst1q_u32(d + 12, v3);
+		s += 16;
+		d += 16;
+	}
+}
+
+#endif
+
+/******************************************************************************/
+
+#if defined(__i386__) || defined(__x86_64__)
+
+/*
+ * The write and copy kernels use non-temporal (streaming) stores, which
+ * bypass the caches and avoid reading the destination cache lines first.
+ */
+
+static int have_sse2(void)
+{
+	return __builtin_cpu_supports("sse2");
+}
+
+static int have_avx2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+static int have_avx512(void)
+{
+	return __builtin_cpu_supports("avx512f");
+}
+
+__attribute__((target("sse2")))
+static void sse2_write(int64_t *dst, int64_t *src, int size)
+{
+	__m128i v = _mm_set1_epi32(0xCCCCCCCC);
+	__m128i *p = (__m128i *)dst, *end = p + size / sizeof(__m128i);
+	while (p < end) {
+		_mm_stream_si128(p, v);
+		_mm_stream_si128(p + 1, v);
+		_mm_stream_si128(p + 2, v);
+		_mm_stream_si128(p + 3, v);
+		p += 4;
+	}
+	_mm_sfence();
+}
+
+__attribute__((target("sse2")))
+static void sse2_read(int64_t *dst, int64_t *src, int size)
+{
+	__m128i *p = (__m128i *)src, *end = p + size / sizeof(__m128i);
+	__m128i s0 = _mm_setzero_si128(), s1 = s0, s2 = s0, s3 = s0;
+	while (p < end) {
+		s0 = _mm_add_epi32(s0, _mm_load_si128(p));
+		s1 = _mm_add_epi32(s1, _mm_load_si128(p + 1));
+		s2 = _mm_add_epi32(s2, _mm_load_si128(p + 2));
+		s3 = _mm_add_epi32(s3, _mm_load_si128(p + 3));
+		p += 4;
+	}
+	s0 = _mm_add_epi32(_mm_add_epi32(s0, s1), _mm_add_epi32(s2, s3));
+	read_sink = _mm_cvtsi128_si32(s0);
+}
+
+__attribute__((target("sse2")))
+static void sse2_copy(int64_t *dst, int64_t *src, int size)
+{
+	__m128i *s = (__m128i *)src, *end = s + size / sizeof(__m128i);
+	__m128i *d = (__m128i *)dst;
+	while (s < end) {
+		__m128i v0 = _mm_load_si128(s), v1 = _mm_load_si128(s + 1);
+		__m128i v2 = _mm_load_si128(s + 2), v3 = _mm_load_si128(s + 3);
+		_mm_stream_si128(d, v0);
+		_mm_stream_si128(d + 1, v1);
+		_mm_stream_si128(d + 2, v2);
+		_mm_stream_si128(d + 3, v3);
+		s += 4;
+		d += 4;
+	}
+	_mm_sfence();
+}
+
+__attribute__((target("avx2")))
+static void avx2_write(int64_t *dst, int64_t *src, int size)
+{
+	__m256i v = _mm256_set1_epi32(0xCCCCCCCC);
+	__m256i *p = (__m256i *)dst, *end = p + size / sizeof(__m256i);
+	while (p < end) {
+		_mm256_stream_si256(p, v);
+		_mm256_stream_si256(p + 1, v);
+		p += 2;
+	}
+	_mm_sfence();
+}
+
+__attribute__((target("avx2")))
+static void avx2_read(int64_t *dst, int64_t *src, int size)
+{
+	__m256i *p = (__m256i *)src, *end = p + size / sizeof(__m256i);
+	__m256i s0 = _mm256_setzero_si256(), s1 = s0;
+	__m128i s;
+	while (p < end) {
+		s0 = _mm256_add_epi32(s0, _mm256_load_si256(p));
+		s1 = _mm256_add_epi32(s1, _mm256_load_si256(p + 1));
+		p += 2;
+	}
+	s0 = _mm256_add_epi32(s0, s1);
+	s = _mm_add_epi32(_mm256_castsi256_si128(s0),
+			  _mm256_extracti128_si256(s0, 1));
+	read_sink = _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("avx2")))
+static void avx2_copy(int64_t *dst, int64_t *src, int size)
+{
+	__m256i *s = (__m256i *)src, *end = s + size / sizeof(__m256i);
+	__m256i *d = (__m256i *)dst;
+	while (s < end) {
+		__m256i v0 = _mm256_load_si256(s);
+		__m256i v1 = _mm256_load_si256(s + 1);
+		_mm256_stream_si256(d, v0);
+		_mm256_stream_si256(d + 1, v1);
+		s += 2;
+		d += 2;
+	}
+	_mm_sfence();
+}
+
+__attribute__((target("avx512f")))
+static void avx512_write(int64_t *dst, int64_t *src, int size)
+{
+	__m512i v = _mm512_set1_epi32(0xCCCCCCCC);
+	__m512i *p = (__m512i *)dst, *end = p + size / sizeof(__m512i);
+	while (p < end) {
+		_mm512_stream_si512(p, v);
+		p++;
+	}
+	_mm_sfence();
+}
+
+__attribute__((target("avx512f")))
+static void avx512_read(int64_t *dst, int64_t *src, int size)
+{
+	__m512i *p = (__m512i *)src, *end = p + size / sizeof(__m512i);
+	__m512i s0 = _mm512_setzero_si512(), s1 = s0;
+	while (p < end) {
+		s0 = _mm512_add_epi32(s0, _mm512_load_si512(p));
+		s1 = _mm512_add_epi32(s1, _mm512_load_si512(p + 1));
+		p += 2;
+	}
+	read_sink = _mm512_reduce_add_epi32(_mm512_add_epi32(s0, s1));
+}
+
+__attribute__((target("avx512f")))
+static void avx512_copy(int64_t *dst, int64_t *src, int size)
+{
+	__m512i *s = (__m512i *)src, *end = s + size / sizeof(__m512i);
+	__m512i *d = (__m512i *)dst;
+	while (s < end) {
+		_mm512_stream_si512(d, _mm512_load_si512(s));
+		s++;
+		d++;
+	}
+	_mm_sfence();
+}
+
+#endif
+
+/******************************************************************************/
+
+const cpu_kernel_t cpu_kernels[] = {
+#ifdef __arm__
+	ARM_ASM_KERNELS(ARM_ASM_KERNEL_ENTRY)
+	ARM_ASM_READ2_KERNELS(ARM_ASM_READ2_ENTRY)
+#endif
+#ifdef __aarch64__
+	{
+		.name = "asimd_write",
+		.description = "use AArch64 ASIMD to fill a memory buffer",
+		.func = asimd_write,
+		.feature = "asimd",
+		.write_multiplier = 1,
+	},
+	{
+		.name = "asimd_read",
+		.description = "use AArch64 ASIMD to read from a memory buffer",
+		.func = asimd_read,
+		.feature = "asimd",
+		.read_multiplier = 1,
+	},
+	{
+		.name = "asimd_copy",
+		.description = "use AArch64 ASIMD to copy a memory buffer",
+		.func = asimd_copy,
+		.feature = "asimd",
+		.read_multiplier = 1,
+		.write_multiplier = 1,
+	},
+#endif
+#if defined(__i386__) || defined(__x86_64__)
+	{
+		.name = "sse2_write",
+		.description = "use SSE2 streaming stores to fill a memory buffer",
+		.func = sse2_write,
+		.supported = have_sse2,
+		.feature = "sse2",
+		.write_multiplier = 1,
+	},
+	{
+		.name = "sse2_read",
+		.description = "use SSE2 to read from a memory buffer",
+		.func = sse2_read,
+		.supported = have_sse2,
+		.feature = "sse2",
+		.read_multiplier = 1,
+	},
+	{
+		.name = "sse2_copy",
+		.description = "use SSE2 streaming stores to copy a memory buffer",
+		.func = sse2_copy,
+		.supported = have_sse2,
+		.feature = "sse2",
+		.read_multiplier = 1,
+		.write_multiplier = 1,
+	},
+	{
+		.name = "avx2_write",
+		.description = "use AVX2 streaming stores to fill a memory buffer",
+		.func = avx2_write,
+		.supported = have_avx2,
+		.feature = "avx2",
+		.write_multiplier = 1,
+	},
+	{
+		.name = "avx2_read",
+		.description = "use AVX2 to read from a memory buffer",
+		.func = avx2_read,
+		.supported = have_avx2,
+		.feature = "avx2",
+		.read_multiplier = 1,
+	},
+	{
+		.name = "avx2_copy",
+		.description = "use AVX2 streaming stores to copy a memory buffer",
+		.func = avx2_copy,
+		.supported = have_avx2,
+		.feature = "avx2",
+		.read_multiplier = 1,
+		.write_multiplier = 1,
+	},
+	{
+		.name = "avx512_write",
+		.description = "use AVX-512 streaming stores to fill a memory buffer",
+		.func = avx512_write,
+		.supported = have_avx512,
+		.feature = "avx512f",
+		.write_multiplier = 1,
+	},
+	{
+		.name = "avx512_read",
+		.description = "use AVX-512 to read from a memory buffer",
+		.func = avx512_read,
+		.supported = have_avx512,
+		.feature = "avx512f",
+		.read_multiplier = 1,
+	},
+	{
+		.name = "avx512_copy",
+		.description = "use AVX-512 streaming stores to copy a memory buffer",
+		.func = avx512_copy,
+		.supported = have_avx512,
+		.feature = "avx512f",
+		.read_multiplier = 1,
+		.write_multiplier = 1,
+	},
+#endif
+	{
+		.name = "stream_copy",
+		.description = "STREAM copy, c = a (doubles)",
+		.arrays_func = stream_copy,
+		.arrays = 2,
+		.feature = "c",
+		.read_multiplier = 1,
+		.write_multiplier = 1,
+	},
+	{
+		.name = "stream_scale",
+		.description = "STREAM scale, b = 3.0 * c (doubles)",
+		.arrays_func = stream_scale,
+		.arrays = 2,
+		.feature = "c",
+		.read_multiplier = 1,
+		.write_multiplier = 1,
+	},
+	{
+		.name = "stream_add",
+		.description = "STREAM add, c = a + b (doubles)",
+		.arrays_func = stream_add,
+		.arrays = 3,
+		.feature = "c",
+		.read_multiplier = 2,
+		.write_multiplier = 1,
+	},
+	{
+		.name = "stream_triad",
+		.description = "STREAM triad, a = b + 3.0 * c (doubles)",
+		.arrays_func = stream_triad,
+		.arrays = 3,
+		.feature = "c",
+		.read_multiplier = 2,
+		.write_multiplier = 1,
+	},
+	{
+		.name = "mix_r1w1",
+		.description = "read one array and write another (1:1)",
+		.arrays_func = mix_r1w1,
+		.arrays = 2,
+		.feature = "c",
+		.read_multiplier = 1,
+		.write_multiplier = 1,
+	},
+	{
+		.name = "mix_r2w1",
+		.description = "read two arrays and write a third one (2:1)",
+		.arrays_func = mix_r2w1,
+		.arrays = 3,
+		.feature = "c",
+		.read_multiplier = 2,
+		.write_multiplier = 1,
+	},
+	{
+		.name = "mix_r3w1",
+		.description = "read three arrays and write a fourth one (3:1)",
+		.arrays_func = mix_r3w1,
+		.arrays = 4,
+		.feature = "c",
+		.read_multiplier = 3,
+		.write_multiplier = 1,
+	},
+	{
+		.name = "c_write",
+		.description = "use generic C code to fill a memory buffer",
+		.func = c_write,
+		.feature = "c",
+		.write_multiplier = 1,
+	},
+	{
+		.name = "c_read",
+		.description = "use generic C code to read from a memory buffer",
+		.func = c_read,
+		.feature = "c",
+		.read_multiplier = 1,
+	},
+	{
+		.name = "c_copy",
+		.description = "use generic C code to copy a memory buffer",
+		.func = c_copy,
+		.feature = "c",
+		.read_multiplier = 1,
+		.write_multiplier = 1,
+	},
+};
+
+const int cpu_kernels_count = sizeof(cpu_kernels) / sizeof(cpu_kernels[0]);
+
+int cpu_kernel_supported(const cpu_kernel_t *kernel)
+{
+	return !kernel->supported || kernel->supported();
+}
+
+int cpu_kernel_arrays(const cpu_kernel_t *kernel)
+{
+	return kernel->arrays_func ? kernel->arrays : 1;
+}
+
+void cpu_kernel_run(const cpu_kernel_t *kernel, int64_t **arrays, int size)
+{
+	if (kernel->arrays_func)
+		kernel->arrays_func(arrays, size);
+	else
+		kernel->func(arrays[0], arrays[0], size);
+}
+
+void *cpu_thread(void *data)
+{
+	workload_t *w = (workload_t *)data;
+	const cpu_kernel_t *kernel = w->extra_data;
+	int64_t *buffers[MAX_KERNEL_ARRAYS], *chunks[MAX_KERNEL_ARRAYS];
+	int i, n = cpu_kernel_arrays(kernel);
+	int chunk_size = w->target_rate > 0 ? PACED_CHUNK_SIZE : CHUNK_SIZE;
+	uint64_t bytes_per_chunk = (uint64_t)chunk_size *
+			(kernel->read_multiplier + kernel->write_multiplier);
+	int offs;
+
+	if (w->cpulist && pin_current_thread(w->cpulist, w->cpu_index) == 0)
+		w->cpu = sched_getcpu();
+	w->buffer_size = n * BUFFER_SIZE;
+
+	/* Allocated after pinning, so that they are local to the cpu's node */
+	for (i = 0; i < n; i++) {
+		if (posix_memalign((void **)&buffers[i], 4096,
+				   BUFFER_SIZE) != 0) {
+			assert(0);
+		}
+		memset(buffers[i], 0xCC, BUFFER_SIZE);
+	}
+
+	while (1) {
+		for (offs = 0; offs < BUFFER_SIZE / sizeof(int64_t);
+		     offs += chunk_size / sizeof(int64_t)) {
+			for (i = 0; i < n; i++)
+				chunks[i] = buffers[i] + offs;
+			cpu_kernel_run(kernel, chunks, chunk_size);
+			workload_add_bytes(w, bytes_per_chunk);
+			workload_pace(w);
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		free(buffers[i]);
+
+	return 0;
+}
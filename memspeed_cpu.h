@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MEMSPEED_CPU_H
+#define MEMSPEED_CPU_H
+
+#include <stdint.h>
+
+#define MAX_KERNEL_ARRAYS 4
+
+typedef struct cpu_kernel_t
+{
+	const char *name;
+	const char *description;
+
+	void (*func)(int64_t *dst, int64_t *src, int size);
+	/* The kernels working on several separate arrays have this one set
+	   instead of 'func' (arrays[0] is the destination) */
+	void (*arrays_func)(int64_t **arrays, int size);
+	int arrays;
+	/* Returns non-zero if the cpu can run the kernel (NULL if always) */
+	int (*supported)(void);
+	/* The name of the required cpu feature, for --list */
+	const char *feature;
+
+	/* The amount of memory traffic per byte of the buffer size (of the
+	   size of each array) */
+	int read_multiplier;
+	int write_multiplier;
+} cpu_kernel_t;
+
+/* The table of all the kernels built for this architecture */
+extern const cpu_kernel_t cpu_kernels[];
+extern const int cpu_kernels_count;
+
+int cpu_kernel_supported(const cpu_kernel_t *kernel);
+
+/* The number of separate arrays used by the kernel */
+int cpu_kernel_arrays(const cpu_kernel_t *kernel);
+
+/* Run the kernel over the first 'size' bytes of each array */
+void cpu_kernel_run(const cpu_kernel_t *kernel, int64_t **arrays, int size);
+
+/* The thread function of the workloads, which have a cpu_kernel_t
+   pointer in 'extra_data' */
+void *cpu_thread(void *data);
+
+#endif
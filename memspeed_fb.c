@@ -22,13 +22,18 @@
  */
 
 #include <stdio.h>
+#include <math.h>
 #include <assert.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/ioctl.h>
 #include <linux/fb.h>
 #include "lima-memspeed.h"
 #include "memspeed_fb.h"
 
+/* The size of the DMA bursts of the display controllers */
+#define SCANOUT_BURST 64
+
 void *fb_blank_thread(void *data)
 {
 	int fd, ret;
@@ -46,32 +51,87 @@ void *fb_blank_thread(void *data)
 	return 0;
 }
 
-void *fb_scanout_thread(void *data)
+/*
+ * The display controller fetches the visible part of each line in whole
+ * bursts, starting at the panned position within the virtual framebuffer.
+ * The margins and the sync pulses (the overscan) are not fetched, but they
+ * are a part of the full timing, which gives the refresh rate.
+ */
+int fb_scanout_open(fb_scanout_t *fb)
 {
-	workload_t *w = (workload_t *)data;
-	int fd, ret, i = 0;
 	struct fb_var_screeninfo var;
-	double refresh_rate, htotal, vtotal;
-	double framebuffer_size;
-	double start_time;
+	struct fb_fix_screeninfo fix;
+	double htotal, vtotal, line_bytes, fetched, start;
+	int lines;
+
+	fb->fd = open("/dev/fb0", O_RDWR);
+	if (fb->fd < 0)
+		return -1;
+	if (ioctl(fb->fd, FBIOGET_VSCREENINFO, &var) < 0 ||
+	    ioctl(fb->fd, FBIOGET_FSCREENINFO, &fix) < 0) {
+		close(fb->fd);
+		return -1;
+	}
 
-	fd = open("/dev/fb0", O_RDWR);
-	assert(fd != -1);
+	htotal = var.left_margin + var.xres + var.right_margin + var.hsync_len;
+	vtotal = var.upper_margin + var.yres + var.lower_margin + var.vsync_len;
+	lines = var.yres;
+	if (var.pixclock) {
+		fb->refresh_rate = 1e12 / var.pixclock / htotal / vtotal;
+	} else {
+		printf("Framebuffer has no pixel clock, assuming 60 Hz\n");
+		fb->refresh_rate = 60;
+	}
+	if ((var.vmode & FB_VMODE_MASK) == FB_VMODE_DOUBLE) {
+		/* every line is sent (and fetched) twice */
+		fb->refresh_rate /= 2;
+		lines *= 2;
+	}
 
-	ret = ioctl(fd, FBIOGET_VSCREENINFO, &var);
-	assert(!ret);
+	line_bytes = (double)var.xres * var.bits_per_pixel / 8;
+	start = (double)var.yoffset * fix.line_length +
+		(double)var.xoffset * var.bits_per_pixel / 8;
+	fetched = ceil(line_bytes / SCANOUT_BURST) * SCANOUT_BURST;
+	/* lines which don't start at a burst boundary need one more burst */
+	if (fmod(start, SCANOUT_BURST) != 0 ||
+	    fix.line_length % SCANOUT_BURST != 0)
+		fetched += SCANOUT_BURST;
+
+	/* for the interlaced modes the refresh rate is the frame rate, each
+	   field has half of the lines */
+	fb->bytes_per_frame = fetched * lines;
+	fb->bandwidth = fb->bytes_per_frame * fb->refresh_rate;
+
+	snprintf(fb->mode, sizeof(fb->mode), "%dx%d%s %dbpp %.2fHz "
+		 "stride %d", var.xres, var.yres,
+		 (var.vmode & FB_VMODE_MASK) == FB_VMODE_INTERLACED ? "i" : "",
+		 var.bits_per_pixel, fb->refresh_rate, fix.line_length);
+	return 0;
+}
 
-	assert(var.vmode == FB_VMODE_NONINTERLACED);
+int fb_scanout_blank(fb_scanout_t *fb, int blank)
+{
+	return ioctl(fb->fd, FBIOBLANK,
+		     blank ? FB_BLANK_NORMAL : FB_BLANK_UNBLANK);
+}
 
-	vtotal = var.left_margin + var.xres + var.right_margin + var.hsync_len;
-	htotal = var.upper_margin + var.yres + var.lower_margin + var.vsync_len;
-	refresh_rate = 1e12 / var.pixclock / htotal / vtotal;
-	framebuffer_size = var.xres * var.yres * (var.bits_per_pixel / 8);
+void *fb_scanout_thread(void *data)
+{
+	workload_t *w = (workload_t *)data;
+	int ret, i = 0;
+	fb_scanout_t fb;
+	double start_time;
 
-	printf("Framebuffer refresh rate: %.1f Hz\n", refresh_rate);
+	ret = fb_scanout_open(&fb);
+	assert(!ret);
+
+	printf("Framebuffer refresh rate: %.1f Hz, scanout %.1f MB/s\n",
+	       fb.refresh_rate, fb.bandwidth / 1000000.);
+	w->buffer_size = fb.bytes_per_frame;
+	snprintf(w->mode, sizeof(w->mode), "%s", fb.mode);
 
 	/* unblank the screen right from the start */
-	ret = ioctl(fd, FBIOBLANK, FB_BLANK_UNBLANK);
+	ret = fb_scanout_blank(&fb, 0);
 	assert(!ret);
 
 	start_time = gettime();
@@ -80,19 +140,16 @@ void *fb_scanout_thread(void *data)
 	while (1) {
 		/* Kick unblank at regular intervals */
 		if (i++ % 600 == 0) {
-			ret = ioctl(fd, FBIOBLANK, FB_BLANK_UNBLANK);
+			ret = fb_scanout_blank(&fb, 0);
 			assert(!ret);
 		}
 
 		/* Sleep a bit (does not really matter how much) */
 		usleep(1000000 / 50);
 
-		pthread_mutex_lock(&bandwidth_counters_mutex);
-		w->bytes_counter = framebuffer_size * refresh_rate *
-				   (gettime() - start_time);
-		pthread_mutex_unlock(&bandwidth_counters_mutex);
+		workload_set_bytes(w, fb.bandwidth * (gettime() - start_time));
 	}
 
-	close(fd);
+	close(fb.fd);
 	return 0;
 }
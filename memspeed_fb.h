@@ -24,6 +24,19 @@
 #ifndef MEMSPEED_FB_H
 #define MEMSPEED_FB_H
 
+typedef struct fb_scanout_t
+{
+	int fd;
+	double refresh_rate;		/* Hz */
+	double bytes_per_frame;		/* fetched by the display controller */
+	double bandwidth;		/* bytes per second */
+	char mode[64];
+} fb_scanout_t;
+
+/* Open /dev/fb0 and estimate the scanout bandwidth from its mode */
+int fb_scanout_open(fb_scanout_t *fb);
+int fb_scanout_blank(fb_scanout_t *fb, int blank);
+
 void *fb_blank_thread(void *data);
 void *fb_scanout_thread(void *data);
 
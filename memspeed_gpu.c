@@ -27,6 +27,7 @@
 #include <time.h>
 #include <errno.h>
 #include <assert.h>
+#include <math.h>
 #include <inttypes.h>
 #include <pthread.h>
 
@@ -40,6 +41,115 @@
 #include "memspeed_gpu.h"
 #include "load_mali_kernel_module.h"
 
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(a)  (sizeof((a)) / sizeof((a)[0]))
+#endif
+
+/*
+ * The bytes of a frame are counted when its PP job has finished (from the
+ * notification thread of limare), not when it is submitted, so the frames
+ * still in the queue do not inflate the bandwidth. The latency of a frame
+ * is the time from its flush to the end of its PP job.
+ */
+#define SUBMIT_RING_SIZE	16	/* more than the frames in flight */
+#define LATENCY_BUCKETS		12	/* < 1 ms, 1-2 ms, ..., >= 1024 ms */
+
+typedef struct gpu_accounting_t
+{
+	workload_t *w;
+	struct limare_state *state;
+	uint64_t bytes_per_frame;
+	double start_time;
+	double submit_time[SUBMIT_RING_SIZE];
+	uint64_t failed_frames;
+	uint64_t latency_histogram[LATENCY_BUCKETS];
+} gpu_accounting_t;
+
+static void gpu_frame_done(struct limare_state *state, unsigned int frame_id,
+			   int success)
+{
+	gpu_accounting_t *acc = state->hook_data;
+	double submit, latency;
+	int bucket = 0;
+
+	if (!success) {
+		__atomic_add_fetch(&acc->failed_frames, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	workload_add_bytes(acc->w, acc->bytes_per_frame);
+	workload_add_frame(acc->w);
+
+	__atomic_load(&acc->submit_time[frame_id % SUBMIT_RING_SIZE], &submit,
+		      __ATOMIC_ACQUIRE);
+	latency = (gettime() - submit) * 1000;
+	while (bucket < LATENCY_BUCKETS - 1 && latency >= (1 << bucket))
+		bucket++;
+	__atomic_add_fetch(&acc->latency_histogram[bucket], 1,
+			   __ATOMIC_RELAXED);
+}
+
+static void gpu_accounting_setup(workload_t *w, struct limare_state *state,
+				 uint64_t bytes_per_frame)
+{
+	gpu_accounting_t *acc = calloc(1, sizeof(gpu_accounting_t));
+	assert(acc);
+
+	acc->w = w;
+	acc->state = state;
+	acc->bytes_per_frame = bytes_per_frame;
+	acc->start_time = gettime();
+	state->hook_data = acc;
+	state->pp_job_done_hook = gpu_frame_done;
+	w->extra_data = acc;
+}
+
+/* Call right before limare_frame_flush() */
+static void gpu_frame_submit(struct limare_state *state)
+{
+	gpu_accounting_t *acc = state->hook_data;
+	struct limare_frame *frame = state->frames[state->frame_current];
+	double t = gettime();
+
+	__atomic_store(&acc->submit_time[frame->id % SUBMIT_RING_SIZE], &t,
+		       __ATOMIC_RELEASE);
+}
+
+void gpu_print_report(workload_t *w)
+{
+	gpu_accounting_t *acc = w->extra_data;
+	long long gp_usec, pp_usec;
+	double elapsed;
+	uint64_t n;
+	int i;
+
+	if (!acc)
+		return;
+	elapsed = gettime() - acc->start_time;
+	limare_job_bench_times(acc->state, &gp_usec, &pp_usec);
+
+	printf("%s: %" PRIu64 " frames (%" PRIu64 " failed) in %.1fs, "
+	       "%.1f fps\n", w->name, workload_frames(w),
+	       __atomic_load_n(&acc->failed_frames, __ATOMIC_RELAXED), elapsed,
+	       workload_frames(w) / elapsed);
+	printf("    GP jobs %.2fs (%.0f%%), PP jobs %.2fs (%.0f%%)\n",
+	       gp_usec / 1e6, gp_usec / 1e4 / elapsed, pp_usec / 1e6,
+	       pp_usec / 1e4 / elapsed);
+	printf("    frame latency:");
+	for (i = 0; i < LATENCY_BUCKETS; i++) {
+		n = __atomic_load_n(&acc->latency_histogram[i],
+				    __ATOMIC_RELAXED);
+		if (!n)
+			continue;
+		if (i == 0)
+			printf(" <1ms: %" PRIu64, n);
+		else if (i == LATENCY_BUCKETS - 1)
+			printf(" >=%dms: %" PRIu64, 1 << (i - 1), n);
+		else
+			printf(" %d-%dms: %" PRIu64, 1 << (i - 1), 1 << i, n);
+	}
+	printf("\n");
+}
+
 void *gpu_write_thread(void *data)
 {
 	workload_t *w = (workload_t *)data;
@@ -58,18 +168,21 @@ void *gpu_write_thread(void *data)
 	assert(ret == 0);
 
 	limare_buffer_size(state, &width, &height);
+	w->buffer_size = width * height * (state->fb->bpp / 8);
+	snprintf(w->mode, sizeof(w->mode), "%dx%d %dbpp", width, height,
+		 state->fb->bpp);
+	gpu_accounting_setup(w, state, w->buffer_size);
 
 	while (1) {
 		state->clear_color = 0xFF000040 + abs((i++ * 1) %
 				((255 - 0x40) * 2) - (255 - 0x40));
 		limare_frame_new(state);
+		gpu_frame_submit(state);
 		ret = limare_frame_flush(state);
 		assert(!ret);
 		limare_buffer_swap(state);
 
-		pthread_mutex_lock(&bandwidth_counters_mutex);
-		w->bytes_counter += width * height * (state->fb->bpp / 8);
-		pthread_mutex_unlock(&bandwidth_counters_mutex);
+		workload_pace(w);
 	}
 
 	limare_finish(state);
@@ -103,11 +216,170 @@ static unsigned char copytest_indices[COPYTEST_TRIANGLE_COUNT][3] = {
 };
 
 
-void *gpu_copy_thread(void *data)
+/*
+ * The 'gpu_tex' family of workloads draws full screen textured quads. The
+ * parameters are appended to the name, separated by '_':
+ *
+ *   565, 888, 8888  the texture format (8888 by default)
+ *   sN              an N x N texture instead of a screen sized one
+ *   xN              N layers of quads per frame (overdraw)
+ *   blend           alpha blending
+ *   depth           depth test, the layers are drawn front to back
+ *   nearest         nearest instead of bilinear filtering
+ *   mip             a full mipmap chain with trilinear filtering
+ *
+ * Mali-400 renders in tiles, so the overdraw, the blending and the depth
+ * test happen in the on-chip tile buffer. All the layers of a tile are
+ * shaded back to back with the same texture coordinates, so only the first
+ * one reads the texels from DRAM and the others hit the texture cache. The
+ * memory traffic of a frame is the write back of the framebuffer and a
+ * single texture read, whatever the number of layers. The read is of the
+ * mipmap level matching the screen size, plus the next smaller one with
+ * the trilinear filtering. limare generates the mipmap levels when the
+ * texture is uploaded.
+ */
+#define GPU_TEX_MAX_SIZE	1024
+#define GPU_TEX_MAX_LAYERS	64
+
+static const struct {
+	const char *name;
+	int format;
+	int bytes_per_texel;
+} gpu_texture_formats[] = {
+	{ "565", LIMA_TEXEL_FORMAT_BGR_565, 2 },
+	{ "888", LIMA_TEXEL_FORMAT_RGB_888, 3 },
+	{ "8888", LIMA_TEXEL_FORMAT_RGBA_8888, 4 },
+};
+
+typedef struct gpu_texture_params_t
+{
+	int format;		/* index in gpu_texture_formats */
+	int size;		/* 0 for the screen size */
+	int layers;
+	int blend;
+	int depth_test;
+	int nearest;
+	int mipmaps;
+} gpu_texture_params_t;
+
+static int gpu_texture_parse(const char *name, gpu_texture_params_t *p)
+{
+	char buf[128], *tok, *save, *end;
+	int i;
+
+	memset(p, 0, sizeof(*p));
+	p->format = 2;
+	p->layers = 1;
+
+	if (strncmp(name, "gpu_tex", 7) || (name[7] && name[7] != '_'))
+		return -1;
+	if (snprintf(buf, sizeof(buf), "%s", name + 7) >= (int)sizeof(buf))
+		return -1;
+
+	for (tok = strtok_r(buf, "_", &save); tok;
+	     tok = strtok_r(NULL, "_", &save)) {
+		for (i = 0; i < (int)ARRAY_SIZE(gpu_texture_formats); i++) {
+			if (strcmp(tok, gpu_texture_formats[i].name) == 0)
+				break;
+		}
+		if (i < (int)ARRAY_SIZE(gpu_texture_formats)) {
+			p->format = i;
+		} else if (tok[0] == 's' && tok[1]) {
+			p->size = strtol(tok + 1, &end, 10);
+			if (*end || p->size < 16 || p->size > GPU_TEX_MAX_SIZE)
+				return -1;
+		} else if (tok[0] == 'x' && tok[1]) {
+			p->layers = strtol(tok + 1, &end, 10);
+			if (*end || p->layers < 1 ||
+			    p->layers > GPU_TEX_MAX_LAYERS)
+				return -1;
+		} else if (strcmp(tok, "blend") == 0) {
+			p->blend = 1;
+		} else if (strcmp(tok, "depth") == 0) {
+			p->depth_test = 1;
+		} else if (strcmp(tok, "nearest") == 0) {
+			p->nearest = 1;
+		} else if (strcmp(tok, "mip") == 0) {
+			p->mipmaps = 1;
+		} else {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int gpu_texture_name_valid(const char *name)
+{
+	gpu_texture_params_t p;
+	return gpu_texture_parse(name, &p) == 0;
+}
+
+static void *checkerboard_new(int width, int height, int bytes_per_texel)
+{
+	uint8_t *texels = malloc(width * height * bytes_per_texel);
+	int x, y, on;
+
+	assert(texels);
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			if (((x * 8 / width) % 2 == 0) ^ ((y * 8 / height) % 2 == 0))
+				on = x % 2;
+			else
+				on = y % 2;
+			memset(texels + (y * width + x) * bytes_per_texel,
+			       on ? 0xFF : 0, bytes_per_texel);
+		}
+	}
+	return texels;
+}
+
+static uint64_t gpu_texture_mip_bytes(const gpu_texture_params_t *p,
+				      int tex_width, int tex_height, int level)
+{
+	int lw = tex_width >> level ? tex_width >> level : 1;
+	int lh = tex_height >> level ? tex_height >> level : 1;
+
+	return (uint64_t)lw * lh *
+	       gpu_texture_formats[p->format].bytes_per_texel;
+}
+
+/*
+ * The bytes of the mipmap levels which are sampled for the screen size.
+ * The level of detail is lambda = log2(scale), the level floor(lambda) is
+ * read and the trilinear filtering also blends in the next smaller level
+ * when lambda is not a whole number.
+ */
+static uint64_t gpu_texture_level_bytes(const gpu_texture_params_t *p,
+					int tex_width, int tex_height,
+					int width, int height)
+{
+	double scale, lambda;
+	int level, max_level = 0;
+
+	if (!p->mipmaps)
+		return gpu_texture_mip_bytes(p, tex_width, tex_height, 0);
+
+	while ((tex_width | tex_height) >> (max_level + 1))
+		max_level++;
+	scale = fmax((double)tex_width / width, (double)tex_height / height);
+	lambda = scale > 1 ? log2(scale) : 0;
+	level = (int)floor(lambda);
+	if (level >= max_level)
+		return gpu_texture_mip_bytes(p, tex_width, tex_height,
+					     max_level);
+	if (p->nearest || lambda == level)
+		return gpu_texture_mip_bytes(p, tex_width, tex_height, level);
+	return gpu_texture_mip_bytes(p, tex_width, tex_height, level) +
+	       gpu_texture_mip_bytes(p, tex_width, tex_height, level + 1);
+}
+
+static void gpu_texture_run(workload_t *w, const gpu_texture_params_t *p)
 {
-	workload_t *w = (workload_t *)data;
 	struct limare_state *state;
-	int ret, width, height, x, y;
+	int ret, width, height, tex_width, tex_height, texture, i;
+	int bytes_per_texel = gpu_texture_formats[p->format].bytes_per_texel;
+	uint64_t fb_bytes, tex_bytes;
+	void *texels;
 
 	#include "shader_v.h"
 	#include "shader_f.h"
@@ -118,9 +390,10 @@ void *gpu_copy_thread(void *data)
 	assert(state);
 
 	ret = limare_state_setup(state, 0, 0, 0xFF505050);
-	assert(state);
+	assert(ret == 0);
 
 	limare_buffer_size(state, &width, &height);
+	w->buffer_size = width * height * (state->fb->bpp / 8);
 
 	int program = limare_program_new(state);
 	vertex_shader_attach_mbs_stream(state, program, vertex_shader_binary,
@@ -136,49 +409,92 @@ void *gpu_copy_thread(void *data)
 				 copytest_texture_coordinates);
 
 	/* Generate a texture */
-	uint32_t *checkerboard_texture = malloc(width * height * sizeof(uint32_t));
-	assert(checkerboard_texture);
-	for (y = 0; y < height; y++) {
-		for (x = 0; x < width; x++) {
-			uint32_t color;
-			if (((x * 8 / width) % 2 == 0) ^ ((y * 8 / height) % 2 == 0))
-				color = (x % 2) ? 0xFFFFFFFF : 0;
-			else
-				color = (y % 2) ? 0xFFFFFFFF : 0;
-			checkerboard_texture[y * width + x] = color;
-		}
+	tex_width = p->size ? p->size : width;
+	tex_height = p->size ? p->size : height;
+	texels = checkerboard_new(tex_width, tex_height, bytes_per_texel);
+	texture = limare_texture_upload(state, texels, tex_width, tex_height,
+					gpu_texture_formats[p->format].format,
+					p->mipmaps);
+	assert(texture >= 0);
+	free(texels);
+	if (p->nearest)
+		ret = limare_texture_parameters(state, texture, GL_NEAREST,
+				p->mipmaps ? GL_NEAREST_MIPMAP_NEAREST :
+					     GL_NEAREST,
+				GL_REPEAT, GL_REPEAT);
+	else
+		ret = limare_texture_parameters(state, texture, GL_LINEAR,
+				p->mipmaps ? GL_LINEAR_MIPMAP_LINEAR :
+					     GL_LINEAR,
+				GL_REPEAT, GL_REPEAT);
+	assert(!ret);
+	limare_texture_attach(state, "in_texture", texture);
+
+	if (p->blend) {
+		limare_enable(state, GL_BLEND);
+		limare_blend_func(state, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	}
+	if (p->depth_test) {
+		limare_enable(state, GL_DEPTH_TEST);
+		limare_depth_func(state, GL_LESS);
 	}
 
-	int texture = limare_texture_upload(state, checkerboard_texture,
-					    width, height,
-					    LIMA_TEXEL_FORMAT_RGBA_8888, 0);
-	limare_texture_attach(state, "in_texture", texture);
+	snprintf(w->mode, sizeof(w->mode), "%dx%d %dbpp tex %dx%d %s x%d%s%s%s",
+		 width, height, state->fb->bpp, tex_width, tex_height,
+		 gpu_texture_formats[p->format].name, p->layers,
+		 p->blend ? " blend" : "", p->depth_test ? " depth" : "",
+		 p->mipmaps ? " mip" : p->nearest ? " nearest" : "");
 
-	ESMatrix modelviewprojection;
-	esMatrixLoadIdentity(&modelviewprojection);
-	esTranslate(&modelviewprojection, 0.0, 0.0, -0.5);
+	fb_bytes = (uint64_t)width * height * (state->fb->bpp / 8);
+	tex_bytes = gpu_texture_level_bytes(p, tex_width, tex_height,
+					    width, height);
+	gpu_accounting_setup(w, state, fb_bytes + tex_bytes);
 
 	while (1) {
-		limare_uniform_attach(state, "modelviewprojectionMatrix", 16,
-				      &modelviewprojection.m[0][0]);
 		limare_frame_new(state);
-		ret = limare_draw_elements(state, GL_TRIANGLES,
-					   COPYTEST_INDEX_COUNT,
-					   &copytest_indices,
-					   GL_UNSIGNED_BYTE);
-		assert(!ret);
+		/* front to back, so that the depth test rejects the layers
+		   behind the first one */
+		for (i = 0; i < p->layers; i++) {
+			ESMatrix modelviewprojection;
+			esMatrixLoadIdentity(&modelviewprojection);
+			esTranslate(&modelviewprojection, 0.0, 0.0,
+				    -0.5 + 0.4 * i / p->layers);
+			limare_uniform_attach(state,
+					      "modelviewprojectionMatrix", 16,
+					      &modelviewprojection.m[0][0]);
+			ret = limare_draw_elements(state, GL_TRIANGLES,
+						   COPYTEST_INDEX_COUNT,
+						   &copytest_indices,
+						   GL_UNSIGNED_BYTE);
+			assert(!ret);
+		}
+		gpu_frame_submit(state);
 		ret = limare_frame_flush(state);
 		assert(!ret);
 		limare_buffer_swap(state);
 
-		pthread_mutex_lock(&bandwidth_counters_mutex);
-		w->bytes_counter += width * height * (state->fb->bpp / 8) +
-				    width * height * 4;
-		pthread_mutex_unlock(&bandwidth_counters_mutex);
+		workload_pace(w);
 	}
 
 	limare_finish(state);
-	free(checkerboard_texture);
+}
+
+void *gpu_copy_thread(void *data)
+{
+	gpu_texture_params_t p = { .format = 2, .layers = 1 };
+
+	gpu_texture_run((workload_t *)data, &p);
+	return 0;
+}
+
+void *gpu_texture_thread(void *data)
+{
+	workload_t *w = (workload_t *)data;
+	gpu_texture_params_t p;
+	int ret;
 
+	ret = gpu_texture_parse(w->name, &p);
+	assert(!ret);
+	gpu_texture_run(w, &p);
 	return 0;
 }
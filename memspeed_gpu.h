@@ -23,7 +23,17 @@
 #ifndef MEMSPEED_GPU_H
 #define MEMSPEED_GPU_H
 
+#include "lima-memspeed.h"
+
 void *gpu_write_thread(void *data);
 void *gpu_copy_thread(void *data);
 
+/* The 'gpu_tex' family, the parameters are taken from the workload name */
+void *gpu_texture_thread(void *data);
+int gpu_texture_name_valid(const char *name);
+
+/* Print the frame counts, the GP and PP job times and the histogram of the
+   frame latencies of a running GPU workload */
+void gpu_print_report(workload_t *w);
+
 #endif
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The memory latency. A chain of dependent loads goes through the cache
+ * lines of the buffer in the order of a random cyclic permutation, so that
+ * neither the prefetchers nor the out of order execution can hide the
+ * latency of each access. The sizes are the same as for the bandwidth
+ * sweep. The whole sweep is done once with 4K pages and once with huge
+ * pages: the difference is the cost of the TLB misses (the page walks).
+ * The workloads from the command line keep running meanwhile, which gives
+ * the loaded latency, and their combined bandwidth is shown for each size.
+ * The chain is walked on a cpu of its own, so that it is not slowed down
+ * by sharing the cpu with a workload thread.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "lima-memspeed.h"
+#include "memspeed_sweep.h"
+#include "memspeed_latency.h"
+#include "cpu_placement.h"
+
+#define LATENCY_TRIALS      5
+#define LATENCY_TRIAL_TIME  0.04
+#define LATENCY_MIN_STEPS   10000
+
+#define MAX_CACHE_LEVELS 4
+#define MAX_SIZES        64
+
+static uint32_t random_state = 2463534242u;
+
+static uint32_t xorshift32(void)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+/* Link the cache lines of the first 'size' bytes of the buffer into a
+   single cycle in a random order, the pointer is at the line start */
+static void build_chain(char *buffer, long size, uint32_t *order)
+{
+	long i, j, lines = size / CACHE_LINE_SIZE;
+	uint32_t tmp;
+
+	for (i = 0; i < lines; i++)
+		order[i] = i;
+	for (i = lines - 1; i > 0; i--) {
+		j = xorshift32() % (i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	for (i = 0; i < lines; i++)
+		*(void **)(buffer + (long)order[i] * CACHE_LINE_SIZE) =
+			buffer + (long)order[(i + 1) % lines] * CACHE_LINE_SIZE;
+}
+
+static void *chase(void *p, long steps)
+{
+	while (steps-- > 0)
+		p = *(void **)p;
+	return p;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+/* The median latency (ns per access) of several trials */
+static double measure(char *buffer, long size)
+{
+	double t, ns[LATENCY_TRIALS];
+	void *volatile sink;
+	void *p = buffer;
+	long steps = size / CACHE_LINE_SIZE;
+	int trial;
+
+	if (steps < LATENCY_MIN_STEPS)
+		steps = LATENCY_MIN_STEPS;
+
+	/* Warm up (the caches and the TLB) and estimate the steps per trial */
+	t = gettime();
+	p = chase(p, steps);
+	t = gettime() - t;
+	if (t > 0 && steps * LATENCY_TRIAL_TIME / t > steps)
+		steps = steps * LATENCY_TRIAL_TIME / t;
+
+	for (trial = 0; trial < LATENCY_TRIALS; trial++) {
+		t = gettime();
+		p = chase(p, steps);
+		ns[trial] = (gettime() - t) * 1e9 / steps;
+	}
+	sink = p;
+	(void)sink;
+
+	qsort(ns, LATENCY_TRIALS, sizeof(double), compare_doubles);
+	return ns[LATENCY_TRIALS / 2];
+}
+
+static uint64_t load_bytes(workload_t *workloads, int n)
+{
+	uint64_t total = 0;
+	int i;
+	for (i = 0; i < n; i++)
+		total += workload_bytes(&workloads[i]);
+	return total;
+}
+
+int latency_sweep(workload_t *workloads, int number_of_workloads, int cpu)
+{
+	double latency[2][MAX_SIZES], load[2][MAX_SIZES], t;
+	long sizes[MAX_SIZES], cache_size[MAX_CACHE_LEVELS], size;
+	int levels = 0, level = 0, hugepages, i, n = 0, step;
+	uint32_t *order;
+	uint64_t bytes;
+	char *buffer;
+	char buf[32];
+
+	if (cpu >= 0) {
+		snprintf(buf, sizeof(buf), "%d", cpu);
+		if (pin_current_thread(buf, -1) < 0)
+			return -1;
+		printf("Measuring the latency on cpu %d\n", cpu);
+	}
+
+	for (size = SWEEP_MIN_SIZE, step = 0; size <= SWEEP_MAX_SIZE &&
+	     n < MAX_SIZES; size = (step++ & 1) ? size / 3 * 4 : size / 2 * 3)
+		sizes[n++] = size;
+
+	order = malloc(SWEEP_MAX_SIZE / CACHE_LINE_SIZE * sizeof(uint32_t));
+	if (!order) {
+		printf("Failed to allocate the latency sweep buffer\n");
+		return -1;
+	}
+
+	for (hugepages = 0; hugepages <= 1; hugepages++) {
+		buffer = alloc_sweep_buffer(SWEEP_MAX_SIZE, hugepages);
+		if (!buffer) {
+			printf("Failed to allocate the latency sweep buffer\n");
+			free(order);
+			return -1;
+		}
+		memset(buffer, 0, SWEEP_MAX_SIZE);
+		if (hugepages)
+			check_huge_pages(buffer, SWEEP_MAX_SIZE);
+
+		printf("Measuring the latency with %s pages",
+		       hugepages ? "huge" : "4K");
+		for (i = 0; i < n; i++) {
+			printf(".");
+			fflush(stdout);
+			build_chain(buffer, sizes[i], order);
+			bytes = load_bytes(workloads, number_of_workloads);
+			t = gettime();
+			latency[hugepages][i] = measure(buffer, sizes[i]);
+			t = gettime() - t;
+			load[hugepages][i] = (load_bytes(workloads,
+					      number_of_workloads) - bytes) /
+					     t / 1000000.;
+		}
+		printf("\n");
+		munmap(buffer, SWEEP_MAX_SIZE);
+	}
+	free(order);
+
+	for (i = 1; i <= MAX_CACHE_LEVELS; i++) {
+		cache_size[levels] = cpu_cache_size(i);
+		if (cache_size[levels] > 0)
+			levels++;
+	}
+
+	printf("\nMemory latency (ns per access)");
+	if (number_of_workloads) {
+		printf(" under the load of");
+		for (i = 0; i < number_of_workloads; i++)
+			printf(" %s", workloads[i].name);
+	}
+	printf(":\n%10s %10s %10s %10s", "size", "4K pages", "huge pages",
+	       "TLB cost");
+	if (number_of_workloads)
+		printf(" %12s", "load MB/s");
+	printf("\n");
+	for (i = 0; i < n; i++) {
+		while (level < levels && sizes[i] > cache_size[level]) {
+			printf("   ---- L%d cache (%s) %s ----\n", level + 1,
+			       format_size(buf, cache_size[level]),
+			       level + 1 == levels ? "-> DRAM" : "exceeded");
+			level++;
+		}
+		printf("%10s %10.1f %10.1f %10.1f", format_size(buf, sizes[i]),
+		       latency[0][i], latency[1][i],
+		       latency[0][i] - latency[1][i]);
+		if (number_of_workloads)
+			printf(" %12.1f", (load[0][i] + load[1][i]) / 2);
+		printf("\n");
+	}
+	return 0;
+}
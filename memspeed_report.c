@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The structured output of the measurements ('--json' and '--csv'), which
+ * can be diffed between runs. The JSON file has all the details including
+ * the samples, the CSV file has one row per workload thread and a row for
+ * the combined bandwidth of each measurement.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "lima-memspeed.h"
+#include "memspeed_report.h"
+
+static FILE *json;
+static FILE *csv;
+static int number_of_options;
+static int number_of_measurements;
+
+void free_measurement(measurement_t *m)
+{
+	free(m->total_samples);
+	free(m->workload_samples);
+	free(m->workload_stats);
+	free(m->workload_perf);
+	free(m->workload_perf_bytes);
+	memset(m, 0, sizeof(*m));
+}
+
+static void json_string(const char *s)
+{
+	fputc('"', json);
+	for (; s && *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(json, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf(json, "\\u%04x", *s);
+		else
+			fputc(*s, json);
+	}
+	fputc('"', json);
+}
+
+static void json_stats(const char *indent, const bandwidth_stats_t *st)
+{
+	fprintf(json, "%s\"mean\": %.1f, \"median\": %.1f, \"min\": %.1f, "
+		"\"max\": %.1f,\n", indent, st->mean, st->median, st->min,
+		st->max);
+	fprintf(json, "%s\"stddev\": %.1f, \"ci95\": %.1f,\n", indent,
+		st->stddev, st->ci95);
+}
+
+static void json_perf(const char *indent, const uint64_t *perf,
+		      uint64_t bytes)
+{
+	int i;
+
+	fprintf(json, "%s\"perf\": { \"bytes\": %" PRIu64, indent, bytes);
+	for (i = 0; i < PERF_EVENTS; i++) {
+		fprintf(json, ", \"%s\": ", perf_event_names[i]);
+		if (perf[i] == PERF_VALUE_NONE)
+			fprintf(json, "null");
+		else
+			fprintf(json, "%" PRIu64, perf[i]);
+	}
+	fprintf(json, " },\n");
+}
+
+static void json_samples(const char *indent, const double *samples, int n,
+			 int stride)
+{
+	int i;
+	fprintf(json, "%s\"samples\": [", indent);
+	for (i = 0; i < n; i++)
+		fprintf(json, "%s%.1f", i ? ", " : "", samples[i * stride]);
+	fprintf(json, "]");
+}
+
+int report_open(const char *json_filename, const char *csv_filename)
+{
+	if (json_filename) {
+		json = fopen(json_filename, "w");
+		if (!json) {
+			perror(json_filename);
+			return -1;
+		}
+		fprintf(json, "{\n  \"version\": 1,\n  \"options\": {");
+	}
+	if (csv_filename) {
+		csv = fopen(csv_filename, "w");
+		if (!csv) {
+			perror(csv_filename);
+			return -1;
+		}
+		fprintf(csv, "jobs,workload,thread,cpu,buffer_size,mode,frames,"
+			"target,mean,median,min,max,stddev,ci95,samples\n");
+	}
+	return 0;
+}
+
+void report_option(const char *name, const char *value)
+{
+	if (!json)
+		return;
+	fprintf(json, "%s\n    ", number_of_options++ ? "," : "");
+	json_string(name);
+	fprintf(json, ": ");
+	json_string(value);
+}
+
+/* RFC 4180 quoting, so that the names and the modes can have commas */
+static void csv_string(const char *s)
+{
+	fputc('"', csv);
+	for (; s && *s; s++) {
+		if (*s == '"')
+			fputc('"', csv);
+		fputc(*s, csv);
+	}
+	fputc('"', csv);
+}
+
+static void csv_row(int jobs, workload_t *w, const bandwidth_stats_t *st,
+		    const double *samples, int n, int stride)
+{
+	int i;
+
+	fprintf(csv, "%d,", jobs);
+	if (w) {
+		csv_string(w->name);
+		fprintf(csv, ",%d,%d,%d,", w->cpu_index, w->cpu,
+			w->buffer_size);
+		csv_string(w->mode);
+		fprintf(csv, ",%" PRIu64 ",%.1f,", workload_frames(w),
+			w->target_rate / 1000000.);
+	} else {
+		fprintf(csv, "total,,,,,,,");
+	}
+	fprintf(csv, "%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,", st->mean, st->median,
+		st->min, st->max, st->stddev, st->ci95);
+	for (i = 0; i < n; i++)
+		fprintf(csv, "%s%.1f", i ? ";" : "", samples[i * stride]);
+	fprintf(csv, "\n");
+}
+
+void report_measurement(int jobs, workload_t *workloads,
+			int number_of_workloads, measurement_t *m)
+{
+	int i, n = number_of_workloads;
+
+	if (csv) {
+		for (i = 0; i < n; i++)
+			csv_row(jobs, &workloads[i], &m->workload_stats[i],
+				m->workload_samples + i, m->number_of_samples,
+				n);
+		csv_row(jobs, NULL, &m->total, m->total_samples,
+			m->number_of_samples, 1);
+		fflush(csv);
+	}
+
+	if (!json)
+		return;
+
+	if (number_of_measurements++ == 0)
+		fprintf(json, "\n  },\n  \"measurements\": [\n");
+	else
+		fprintf(json, ",\n");
+
+	fprintf(json, "    {\n      \"jobs\": %d,\n", jobs);
+	fprintf(json, "      \"warmup_time\": %.2f,\n", m->warmup_time);
+	fprintf(json, "      \"sample_interval\": %g,\n", m->sample_interval);
+	fprintf(json, "      \"total\": {\n");
+	json_stats("        ", &m->total);
+	json_samples("        ", m->total_samples, m->number_of_samples, 1);
+	fprintf(json, "\n      },\n      \"workloads\": [\n");
+	for (i = 0; i < n; i++) {
+		workload_t *w = &workloads[i];
+		fprintf(json, "        {\n          \"name\": ");
+		json_string(w->name);
+		fprintf(json, ",\n          \"thread\": %d, \"cpu\": %d, "
+			"\"buffer_size\": %d,\n", w->cpu_index, w->cpu,
+			w->buffer_size);
+		fprintf(json, "          \"mode\": ");
+		json_string(w->mode);
+		fprintf(json, ", \"frames\": %" PRIu64 ",\n",
+			workload_frames(w));
+		fprintf(json, "          \"target\": %.1f,\n",
+			w->target_rate / 1000000.);
+		if (m->workload_perf)
+			json_perf("          ", m->workload_perf + i * PERF_EVENTS,
+				  m->workload_perf_bytes[i]);
+		json_stats("          ", &m->workload_stats[i]);
+		json_samples("          ", m->workload_samples + i,
+			     m->number_of_samples, n);
+		fprintf(json, "\n        }%s\n", i + 1 < n ? "," : "");
+	}
+	fprintf(json, "      ]\n    }");
+	fflush(json);
+}
+
+void report_close(void)
+{
+	if (json) {
+		if (number_of_measurements == 0)
+			fprintf(json, "\n  },\n  \"measurements\": [");
+		fprintf(json, "\n  ]\n}\n");
+		fclose(json);
+		json = NULL;
+	}
+	if (csv) {
+		fclose(csv);
+		csv = NULL;
+	}
+}
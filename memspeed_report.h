@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MEMSPEED_REPORT_H
+#define MEMSPEED_REPORT_H
+
+#include "lima-memspeed.h"
+#include "memspeed_stats.h"
+
+/* The result of measuring a set of running workloads */
+typedef struct measurement_t
+{
+	double warmup_time;
+	double sample_interval;
+	int number_of_samples;
+	/* The combined bandwidth of each sample (MB/s) */
+	double *total_samples;
+	/* [sample * number_of_workloads + workload] (MB/s) */
+	double *workload_samples;
+
+	bandwidth_stats_t total;
+	bandwidth_stats_t *workload_stats;
+
+	/* The hardware counters of each workload over the samples
+	   ([workload * PERF_EVENTS + event]) and the bytes transferred over
+	   the same time, NULL if not enabled */
+	uint64_t *workload_perf;
+	uint64_t *workload_perf_bytes;
+} measurement_t;
+
+void free_measurement(measurement_t *m);
+
+/* Open the structured output files (either can be NULL) */
+int report_open(const char *json_filename, const char *csv_filename);
+
+/* Add a setting of the run to the "options" object of the JSON output */
+void report_option(const char *name, const char *value);
+
+/* Add one measurement. 'jobs' is the number of threads of each CPU
+   workload ('-j'), 0 if not used. */
+void report_measurement(int jobs, workload_t *workloads,
+			int number_of_workloads, measurement_t *m);
+
+void report_close(void);
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "memspeed_stats.h"
+
+/* Two-sided 95% quantiles of the Student's t-distribution for 1..30
+   degrees of freedom (the normal distribution is close enough above) */
+static const double t95[] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+static int compare_doubles(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+void compute_stats(const double *samples, int n, bandwidth_stats_t *stats)
+{
+	double *sorted, s1 = 0, s2 = 0;
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->n = n;
+	if (n == 0)
+		return;
+
+	sorted = malloc(n * sizeof(double));
+	assert(sorted);
+	memcpy(sorted, samples, n * sizeof(double));
+	qsort(sorted, n, sizeof(double), compare_doubles);
+
+	for (i = 0; i < n; i++) {
+		s1 += sorted[i];
+		s2 += sorted[i] * sorted[i];
+	}
+	stats->mean = s1 / n;
+	stats->min = sorted[0];
+	stats->max = sorted[n - 1];
+	if (n % 2)
+		stats->median = sorted[n / 2];
+	else
+		stats->median = (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+	if (n >= 2) {
+		double var = (n * s2 - s1 * s1) / ((double)n * (n - 1));
+		stats->stddev = var > 0 ? sqrt(var) : 0;
+		stats->ci95 = (n - 1 <= 30 ? t95[n - 2] : 1.96) *
+			      stats->stddev / sqrt(n);
+	}
+	free(sorted);
+}
+
+double relative_ci95(const bandwidth_stats_t *stats)
+{
+	if (stats->mean <= 0)
+		return 0;
+	return stats->ci95 / stats->mean * 100;
+}
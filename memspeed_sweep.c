@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The working set size sweep. A CPU kernel is run over geometrically spaced
+ * buffer sizes (two per octave) from 4 KiB to 256 MiB, which shows the
+ * bandwidth of each level of the memory hierarchy. The buffer is backed by
+ * 4K pages (transparent huge pages are disabled for it) or by huge pages,
+ * so that the cost of the TLB misses can be told apart from the cache
+ * misses. Each size gets about 0.2 seconds, so that a whole sweep of one
+ * kernel takes less than 10 seconds.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "lima-memspeed.h"
+#include "memspeed_sweep.h"
+#include "cpu_placement.h"
+
+
+#define SWEEP_TRIALS     5
+#define SWEEP_TRIAL_TIME 0.04
+
+#define MAX_CACHE_LEVELS 4
+
+void *alloc_sweep_buffer(size_t size, int hugepages)
+{
+	char *buf, *aligned;
+
+	if (hugepages) {
+		buf = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (buf != MAP_FAILED)
+			return buf;
+		printf("No hugetlbfs pages reserved (see "
+		       "/proc/sys/vm/nr_hugepages), trying transparent huge "
+		       "pages\n");
+	}
+
+	/* Over-allocate in order to align the buffer to the huge page size */
+	buf = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED)
+		return NULL;
+	aligned = (char *)(((uintptr_t)buf + HUGE_PAGE_SIZE - 1) &
+			   ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+	if (aligned != buf)
+		munmap(buf, aligned - buf);
+	munmap(aligned + size, buf + HUGE_PAGE_SIZE - aligned);
+	/* MADV_NOHUGEPAGE only fails if there are no huge pages anyway */
+	if (madvise(aligned, size, hugepages ? MADV_HUGEPAGE :
+						 MADV_NOHUGEPAGE) < 0 &&
+	    hugepages)
+		printf("Transparent huge pages are not available either\n");
+	return aligned;
+}
+
+long huge_page_bytes(const void *buffer)
+{
+	unsigned long start, end, kb;
+	long bytes = -1;
+	char line[256];
+	int found = 0;
+	FILE *f;
+
+	f = fopen("/proc/self/smaps", "r");
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+			if (found)
+				break;
+			found = start <= (uintptr_t)buffer &&
+				(uintptr_t)buffer < end;
+			if (found)
+				bytes = 0;
+		} else if (found &&
+			   (sscanf(line, "AnonHugePages: %lu", &kb) == 1 ||
+			    sscanf(line, "Shared_Hugetlb: %lu", &kb) == 1 ||
+			    sscanf(line, "Private_Hugetlb: %lu", &kb) == 1)) {
+			bytes += kb * 1024;
+		}
+	}
+	fclose(f);
+	return bytes;
+}
+
+void check_huge_pages(const void *buffer, size_t size)
+{
+	long bytes = huge_page_bytes(buffer);
+	char buf1[32], buf2[32];
+
+	if (bytes >= 0 && (size_t)bytes < size)
+		printf("Warning: only %s of the %s buffer is backed by huge "
+		       "pages\n", format_size(buf1, bytes),
+		       format_size(buf2, size));
+}
+
+/*
+ * The best bandwidth (MB/s) out of several trials. The kernels using
+ * several arrays get 'size' split between them, so that 'size' is the
+ * whole working set.
+ */
+static double measure(const cpu_kernel_t *kernel, int64_t *buf, int size)
+{
+	int64_t *arrays[MAX_KERNEL_ARRAYS];
+	int i, n, trial, number_of_arrays = cpu_kernel_arrays(kernel);
+	double bytes, t, best = 0;
+
+	size = size / number_of_arrays & ~255;
+	for (i = 0; i < number_of_arrays; i++)
+		arrays[i] = buf + i * (size / sizeof(int64_t));
+	bytes = (double)size *
+		(kernel->read_multiplier + kernel->write_multiplier);
+
+	/* Warm up the caches and estimate the number of calls per trial */
+	t = gettime();
+	cpu_kernel_run(kernel, arrays, size);
+	t = gettime() - t;
+	n = t > 0 ? SWEEP_TRIAL_TIME / t : 1000;
+	if (n < 1)
+		n = 1;
+
+	for (trial = 0; trial < SWEEP_TRIALS; trial++) {
+		t = gettime();
+		for (i = 0; i < n; i++)
+			cpu_kernel_run(kernel, arrays, size);
+		t = gettime() - t;
+		if (bytes * n / t > best)
+			best = bytes * n / t;
+	}
+	return best / 1000000.;
+}
+
+const char *format_size(char *buf, long size)
+{
+	if (size % (1024 * 1024) == 0)
+		sprintf(buf, "%ldM", size >> 20);
+	else
+		sprintf(buf, "%ldK", size >> 10);
+	return buf;
+}
+
+int cpu_kernel_sweep(const cpu_kernel_t *kernel, int hugepages)
+{
+	long cache_size[MAX_CACHE_LEVELS + 1];
+	double bw, level_bw[MAX_CACHE_LEVELS + 2];
+	int level_points[MAX_CACHE_LEVELS + 2];
+	int64_t *buffer;
+	char buf[32];
+	long size;
+	int levels = 0, level = 0, i, step;
+
+	buffer = alloc_sweep_buffer(SWEEP_MAX_SIZE, hugepages);
+	if (!buffer) {
+		printf("Failed to allocate the sweep buffer\n");
+		return -1;
+	}
+	memset(buffer, 0xCC, SWEEP_MAX_SIZE);
+	if (hugepages)
+		check_huge_pages(buffer, SWEEP_MAX_SIZE);
+
+	for (i = 1; i <= MAX_CACHE_LEVELS; i++) {
+		cache_size[levels] = cpu_cache_size(i);
+		if (cache_size[levels] > 0)
+			levels++;
+	}
+	memset(level_bw, 0, sizeof(level_bw));
+	memset(level_points, 0, sizeof(level_points));
+
+	printf("\nSweep of '%s' with %s pages:\n", kernel->name,
+	       hugepages ? "huge" : "4K");
+	printf("%10s %12s\n", "size", "MB/s");
+
+	/* The sizes are 2^k and 1.5 * 2^k */
+	for (size = SWEEP_MIN_SIZE, step = 0; size <= SWEEP_MAX_SIZE;
+	     size = (step++ & 1) ? size / 3 * 4 : size / 2 * 3) {
+		while (level < levels && size > cache_size[level]) {
+			printf("   ---- L%d cache (%s) %s ----\n", level + 1,
+			       format_size(buf, cache_size[level]),
+			       level + 1 == levels ? "-> DRAM" : "exceeded");
+			level++;
+		}
+		bw = measure(kernel, buffer, size);
+		printf("%10s %12.1f\n", format_size(buf, size), bw);
+		fflush(stdout);
+
+		/* Only the sizes well inside of each level for the summary */
+		if ((level < levels && size * 2 <= cache_size[level]) ||
+		    (level == levels && (!levels ||
+					 size >= cache_size[levels - 1] * 4))) {
+			level_bw[level] += bw;
+			level_points[level]++;
+		}
+	}
+
+	printf("Plateaus:");
+	for (i = 0; i <= levels; i++) {
+		if (!level_points[i])
+			continue;
+		if (i == levels)
+			printf(" %s", levels ? "DRAM" : "all sizes");
+		else
+			printf(" L%d", i + 1);
+		printf(" %.1f MB/s", level_bw[i] / level_points[i]);
+	}
+	printf("\n");
+
+	munmap(buffer, SWEEP_MAX_SIZE);
+	return 0;
+}
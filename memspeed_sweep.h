@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MEMSPEED_SWEEP_H
+#define MEMSPEED_SWEEP_H
+
+#include <stddef.h>
+#include "memspeed_cpu.h"
+
+#define SWEEP_MIN_SIZE   (4 * 1024)
+#define SWEEP_MAX_SIZE   (256 * 1024 * 1024)
+#define HUGE_PAGE_SIZE   (2 * 1024 * 1024)
+
+/* A buffer aligned to the huge page size, backed by huge pages or by 4K
+   pages (the transparent huge pages are disabled for it), munmap it */
+void *alloc_sweep_buffer(size_t size, int hugepages);
+
+/* The bytes of the mapping at 'buffer' which are backed by huge pages
+   (transparent or hugetlbfs) according to /proc/self/smaps, or -1 */
+long huge_page_bytes(const void *buffer);
+
+/* Warn if the touched buffer did not get huge pages for all of it */
+void check_huge_pages(const void *buffer, size_t size);
+
+/* "512K" or "16M" */
+const char *format_size(char *buf, long size);
+
+/* Measure the bandwidth of the kernel over a range of buffer sizes and
+   print it, together with the cache size boundaries */
+int cpu_kernel_sweep(const cpu_kernel_t *kernel, int hugepages);
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The time series of the bandwidth. The sampler thread only reads the byte
+ * counters at absolute deadlines (so the interval does not drift) and keeps
+ * the raw values in memory. Nothing is printed until the sampling is
+ * stopped, so short intervals (10 ms) do not disturb the measurements.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "lima-memspeed.h"
+#include "memspeed_timeseries.h"
+
+static workload_t *sampled_workloads;
+static int number_of_sampled_workloads;
+static double sample_interval;
+
+static pthread_t sampler_thread_id;
+static volatile int stop_sampling;
+
+/* 'number_of_samples' rows of the time and the byte counters */
+static double *sample_times;
+static uint64_t *samples;
+static int number_of_samples, allocated_samples;
+
+static void add_sample(double t)
+{
+	int i;
+
+	if (number_of_samples == allocated_samples) {
+		allocated_samples = allocated_samples ? allocated_samples * 2
+						      : 1024;
+		sample_times = realloc(sample_times,
+				       allocated_samples * sizeof(double));
+		samples = realloc(samples, sizeof(uint64_t) *
+				  allocated_samples * number_of_sampled_workloads);
+		assert(sample_times && samples);
+	}
+	sample_times[number_of_samples] = t;
+	for (i = 0; i < number_of_sampled_workloads; i++) {
+		samples[number_of_samples * number_of_sampled_workloads + i] =
+			workload_bytes(&sampled_workloads[i]);
+	}
+	number_of_samples++;
+}
+
+static void *sampler_thread(void *data)
+{
+	struct timespec deadline, interval;
+
+	/* split up front, a long is too small for the nanoseconds on 32-bit */
+	interval.tv_sec = (time_t)sample_interval;
+	interval.tv_nsec = (long)((sample_interval - interval.tv_sec) * 1e9);
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	while (!stop_sampling) {
+		add_sample(gettime());
+
+		deadline.tv_sec += interval.tv_sec;
+		deadline.tv_nsec += interval.tv_nsec;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_nsec -= 1000000000;
+			deadline.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline,
+				NULL);
+	}
+	return 0;
+}
+
+void timeseries_start(workload_t *workloads, int number_of_workloads,
+		      double interval)
+{
+	sampled_workloads = workloads;
+	number_of_sampled_workloads = number_of_workloads;
+	sample_interval = interval;
+	number_of_samples = 0;
+	stop_sampling = 0;
+	pthread_create(&sampler_thread_id, NULL, sampler_thread, NULL);
+}
+
+void timeseries_stop_and_print(void)
+{
+	int i, j, n = number_of_sampled_workloads;
+	double dt, bw, total;
+
+	stop_sampling = 1;
+	pthread_join(sampler_thread_id, NULL);
+
+	printf("Bandwidth time series (MB/s, sampled every %g ms):\n",
+	       sample_interval * 1000);
+	printf("%10s", "time");
+	for (i = 0; i < n; i++)
+		printf(" %12.12s", sampled_workloads[i].name);
+	printf(" %12s\n", "total");
+
+	for (j = 1; j < number_of_samples; j++) {
+		dt = sample_times[j] - sample_times[j - 1];
+		total = 0;
+		printf("%10.3f", sample_times[j] - sample_times[0]);
+		for (i = 0; i < n; i++) {
+			bw = (samples[j * n + i] - samples[(j - 1) * n + i]) /
+			     dt / 1000000.;
+			total += bw;
+			printf(" %12.1f", bw);
+		}
+		printf(" %12.1f\n", total);
+	}
+}
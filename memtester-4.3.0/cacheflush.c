@@ -0,0 +1,91 @@
+/*
+ * CPU cache eviction for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * When the tests are run on cache sized chunks, the data must be written
+ * back to DRAM and dropped from the caches before it is verified, otherwise
+ * only the caches would be tested.  The cache maintenance instructions are
+ * used where they are available to userspace (clflush on x86, dc civac on
+ * 64-bit ARM).  Elsewhere (32-bit ARM has no such instructions accessible
+ * from userspace) the caches are thrashed by reading a buffer, which is
+ * twice as large as the biggest cache.
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "cacheflush.h"
+#include "cpu_placement.h"
+
+#if !defined(__x86_64__) && !defined(__SSE2__) && !defined(__aarch64__)
+static ulv *evict_buf;
+static size_t evict_count;
+#endif
+
+/* Can be called more than once, only the first call does the work */
+int cache_flush_init(void) {
+#if !defined(__x86_64__) && !defined(__SSE2__) && !defined(__aarch64__)
+    long size = 0, level_size;
+    int level;
+    size_t i;
+
+    if (evict_buf) {
+        return 0;
+    }
+    for (level = 1; level <= 4; level++) {
+        level_size = cpu_cache_size(level);
+        if (level_size > size) {
+            size = level_size;
+        }
+    }
+    if (!size) {
+        /* Unknown, assume a typical L2 cache of the ARM SoCs */
+        size = 1 << 20;
+    }
+    evict_count = 2 * size / sizeof(ul);
+    evict_buf = malloc(evict_count * sizeof(ul));
+    if (!evict_buf) {
+        return -1;
+    }
+    for (i = 0; i < evict_count; i++) {
+        evict_buf[i] = i;
+    }
+#endif
+    return 0;
+}
+
+void cache_flush(void volatile *addr, size_t len) {
+#if defined(__x86_64__) || defined(__SSE2__)
+    char volatile *p = (char volatile *) ((size_t) addr & ~(size_t) 63);
+    char volatile *end = (char volatile *) addr + len;
+
+    for (; p < end; p += 64) {
+        __asm__ volatile("clflush %0" : "+m" (*p));
+    }
+    __asm__ volatile("mfence" ::: "memory");
+#elif defined(__aarch64__)
+    size_t ctr, line;
+    char volatile *p, *end = (char volatile *) addr + len;
+
+    __asm__ volatile("mrs %0, ctr_el0" : "=r" (ctr));
+    line = 4 << ((ctr >> 16) & 0xf);
+    p = (char volatile *) ((size_t) addr & ~(line - 1));
+    for (; p < end; p += line) {
+        __asm__ volatile("dc civac, %0" : : "r" (p) : "memory");
+    }
+    __asm__ volatile("dsb sy" ::: "memory");
+#else
+    size_t i;
+
+    (void) addr;
+    (void) len;
+    /* one read per 32 bytes is enough to touch every cache line */
+    for (i = 0; i < evict_count; i += 32 / sizeof(ul)) {
+        (void) evict_buf[i];
+    }
+#endif
+}
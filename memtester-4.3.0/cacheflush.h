@@ -0,0 +1,13 @@
+/*
+ * CPU cache eviction for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for writing the tested memory back
+ * to DRAM and dropping it from the CPU caches.
+ *
+ */
+
+int cache_flush_init(void);
+void cache_flush(void volatile *addr, size_t len);
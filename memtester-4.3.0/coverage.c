@@ -0,0 +1,313 @@
+/*
+ * Physical page coverage tracking for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * memtester tests malloc'ed (virtual) memory, so normally there is no record
+ * of which physical pages have been exercised.  The coverage map is a bitmap
+ * indexed by the page frame number (PFN) obtained from /proc/self/pagemap.
+ * It is updated after the memory has been tested, saved to a file after each
+ * loop and merged with the contents of that file on startup, so that the
+ * coverage accumulates across runs.  Reading PFNs from pagemap requires
+ * CAP_SYS_ADMIN (root) on Linux 4.2 and newer.
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "types.h"
+#include "memtester.h"
+#include "coverage.h"
+
+#define PAGEMAP_PFN_MASK    ((1ULL << 55) - 1)
+#define PAGEMAP_PRESENT     (1ULL << 63)
+#define PAGEMAP_BATCH       512
+#define MAP_MAGIC           "MTCOVER1"
+#define MAX_REPORTED_RANGES 4
+
+struct coverage_file_header {
+    char magic[8];
+    unsigned int pagesize;
+    unsigned int reserved;
+    ull frames;
+};
+
+static const char *map_filename;
+static size_t map_pagesize;
+static unsigned char *bitmap;
+static ull bitmap_frames;
+static int pagemap_fd = -1;
+
+static int bitmap_reserve(ull frames) {
+    unsigned char *p;
+    ull newframes;
+
+    if (frames <= bitmap_frames) {
+        return 0;
+    }
+    /* grow in 64K frame steps to avoid frequent reallocations */
+    newframes = (frames + 0xFFFF) & ~0xFFFFULL;
+    p = realloc(bitmap, newframes / 8);
+    if (!p) {
+        return -1;
+    }
+    memset(p + bitmap_frames / 8, 0, (newframes - bitmap_frames) / 8);
+    bitmap = p;
+    bitmap_frames = newframes;
+    return 0;
+}
+
+static int frame_tested(ull pfn) {
+    return pfn < bitmap_frames && (bitmap[pfn / 8] & (1 << (pfn % 8)));
+}
+
+static void coverage_load(void) {
+    struct coverage_file_header hdr;
+    unsigned char buf[4096];
+    size_t n, i;
+    ull pos = 0;
+    FILE *f = fopen(map_filename, "rb");
+
+    if (!f) {
+        if (errno != ENOENT) {
+            fprintf(stderr, "coverage: can't open %s: %s\n", map_filename,
+                    strerror(errno));
+        }
+        return;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+        memcmp(hdr.magic, MAP_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.pagesize != map_pagesize || bitmap_reserve(hdr.frames)) {
+        fprintf(stderr, "coverage: ignoring incompatible map %s\n",
+                map_filename);
+        fclose(f);
+        return;
+    }
+    while (pos < hdr.frames / 8 && (n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        for (i = 0; i < n && pos < hdr.frames / 8; i++) {
+            bitmap[pos++] |= buf[i];
+        }
+    }
+    fclose(f);
+}
+
+int coverage_init(const char *filename, size_t pagesize) {
+    map_filename = filename;
+    map_pagesize = pagesize;
+
+    pagemap_fd = open("/proc/self/pagemap", O_RDONLY);
+    if (pagemap_fd == -1) {
+        fprintf(stderr, "coverage: can't open /proc/self/pagemap: %s\n",
+                strerror(errno));
+        return -1;
+    }
+    coverage_load();
+    return 0;
+}
+
+int coverage_enabled(void) {
+    return pagemap_fd != -1;
+}
+
+/* Look up the PFNs for up to PAGEMAP_BATCH pages, 0 is stored for the pages
+   which are not present.  Returns the number of pages with a known PFN. */
+static size_t lookup_pfns(size_t vaddr, size_t npages, ull *pfns) {
+    off_t offset = (off_t) (vaddr / map_pagesize) * sizeof(ull);
+    ssize_t len;
+    size_t i, found = 0;
+
+    len = pread(pagemap_fd, pfns, npages * sizeof(ull), offset);
+    if (len != (ssize_t) (npages * sizeof(ull))) {
+        return 0;
+    }
+    for (i = 0; i < npages; i++) {
+        if ((pfns[i] & PAGEMAP_PRESENT) && (pfns[i] & PAGEMAP_PFN_MASK)) {
+            pfns[i] &= PAGEMAP_PFN_MASK;
+            found++;
+        } else {
+            pfns[i] = 0;
+        }
+    }
+    return found;
+}
+
+void coverage_mark(void volatile *addr, size_t len) {
+    ull pfns[PAGEMAP_BATCH];
+    size_t vaddr = (size_t) addr, n, i, found = 0;
+    size_t npages = len / map_pagesize;
+
+    if (pagemap_fd == -1) {
+        return;
+    }
+    while (npages) {
+        n = npages < PAGEMAP_BATCH ? npages : PAGEMAP_BATCH;
+        found += lookup_pfns(vaddr, n, pfns);
+        for (i = 0; i < n; i++) {
+            if (pfns[i] && bitmap_reserve(pfns[i] + 1) == 0) {
+                bitmap[pfns[i] / 8] |= 1 << (pfns[i] % 8);
+            }
+        }
+        vaddr += n * map_pagesize;
+        npages -= n;
+    }
+    if (!found && len >= map_pagesize) {
+        fprintf(stderr, "coverage: /proc/self/pagemap provides no PFNs "
+                "(root is required), coverage tracking disabled\n");
+        close(pagemap_fd);
+        pagemap_fd = -1;
+    }
+}
+
+/* The fraction of the pages in the range, which are backed by frames that
+   have never been tested (or 1.0 if this is unknown). */
+double coverage_fresh_ratio(void volatile *addr, size_t len) {
+    ull pfns[PAGEMAP_BATCH];
+    size_t vaddr = (size_t) addr, n, i, known = 0, fresh = 0;
+    size_t npages = len / map_pagesize;
+
+    if (pagemap_fd == -1) {
+        return 1.0;
+    }
+    while (npages) {
+        n = npages < PAGEMAP_BATCH ? npages : PAGEMAP_BATCH;
+        known += lookup_pfns(vaddr, n, pfns);
+        for (i = 0; i < n; i++) {
+            if (pfns[i] && !frame_tested(pfns[i])) {
+                fresh++;
+            }
+        }
+        vaddr += n * map_pagesize;
+        npages -= n;
+    }
+    return known ? (double) fresh / known : 1.0;
+}
+
+void coverage_save(void) {
+    struct coverage_file_header hdr;
+    char *tmpname;
+    FILE *f;
+    int ok;
+
+    if (!map_filename || !bitmap) {
+        return;
+    }
+    tmpname = malloc(strlen(map_filename) + 5);
+    if (!tmpname) {
+        return;
+    }
+    sprintf(tmpname, "%s.tmp", map_filename);
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MAP_MAGIC, sizeof(hdr.magic));
+    hdr.pagesize = map_pagesize;
+    hdr.frames = bitmap_frames;
+
+    f = fopen(tmpname, "wb");
+    ok = f && fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+         fwrite(bitmap, 1, bitmap_frames / 8, f) == bitmap_frames / 8;
+    if (f && fclose(f) != 0) {
+        ok = 0;
+    }
+    /* replace the old map atomically, so that a crash can't corrupt it */
+    if (!ok || rename(tmpname, map_filename) != 0) {
+        fprintf(stderr, "coverage: failed to save %s: %s\n", map_filename,
+                strerror(errno));
+        unlink(tmpname);
+    }
+    free(tmpname);
+}
+
+struct untested_range {
+    ull first, count;
+};
+
+static void add_untested_range(struct untested_range *r, ull first,
+                               ull count) {
+    int i, smallest = 0;
+
+    for (i = 1; i < MAX_REPORTED_RANGES; i++) {
+        if (r[i].count < r[smallest].count) {
+            smallest = i;
+        }
+    }
+    if (count > r[smallest].count) {
+        r[smallest].first = first;
+        r[smallest].count = count;
+    }
+}
+
+static int compare_ranges(const void *a, const void *b) {
+    const struct untested_range *ra = a, *rb = b;
+    return ra->first < rb->first ? -1 : ra->first > rb->first;
+}
+
+void coverage_report(void) {
+    struct untested_range ranges[MAX_REPORTED_RANGES];
+    char line[256];
+    ull start, end, pfn, run_start = 0, tested = 0, ram = 0, untested = 0;
+    int i, have_ram = 0;
+    FILE *f;
+
+    if (!bitmap) {
+        return;
+    }
+    for (pfn = 0; pfn < bitmap_frames; pfn++) {
+        if (frame_tested(pfn)) {
+            tested++;
+        }
+    }
+    printf("  coverage: %lluMB tested so far (%llu frames)",
+           tested * map_pagesize >> 20, tested);
+
+    /* Only the top level "System RAM" entries are interesting, the
+       addresses in /proc/iomem are all zero when not running as root. */
+    memset(ranges, 0, sizeof(ranges));
+    f = fopen("/proc/iomem", "r");
+    while (f && fgets(line, sizeof(line), f)) {
+        if (line[0] == ' ' || !strstr(line, ": System RAM") ||
+            sscanf(line, "%llx-%llx", &start, &end) != 2 || end <= start) {
+            continue;
+        }
+        have_ram = 1;
+        start = (start + map_pagesize - 1) / map_pagesize;
+        end = (end + 1) / map_pagesize;
+        ram += end - start;
+        for (pfn = start; pfn <= end; pfn++) {
+            if (pfn < end && !frame_tested(pfn)) {
+                if (!run_start) {
+                    run_start = pfn + 1;
+                }
+                untested++;
+            } else if (run_start) {
+                add_untested_range(ranges, run_start - 1, pfn - run_start + 1);
+                run_start = 0;
+            }
+        }
+    }
+    if (f) {
+        fclose(f);
+    }
+    if (!have_ram) {
+        printf("\n");
+        return;
+    }
+    printf(", %lluMB of %lluMB System RAM never tested\n",
+           untested * map_pagesize >> 20, ram * map_pagesize >> 20);
+    qsort(ranges, MAX_REPORTED_RANGES, sizeof(ranges[0]), compare_ranges);
+    for (i = 0; i < MAX_REPORTED_RANGES; i++) {
+        if (ranges[i].count) {
+            printf("  coverage: untested 0x%09llx-0x%09llx (%lluKB)\n",
+                   ranges[i].first * map_pagesize,
+                   (ranges[i].first + ranges[i].count) * map_pagesize - 1,
+                   ranges[i].count * map_pagesize >> 10);
+        }
+    }
+    fflush(stdout);
+}
@@ -0,0 +1,17 @@
+/*
+ * Physical page coverage tracking for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the coverage map, which records
+ * the page frame numbers (PFNs) of the memory that has been tested.
+ *
+ */
+
+int coverage_init(const char *filename, size_t pagesize);
+int coverage_enabled(void);
+void coverage_mark(void volatile *addr, size_t len);
+double coverage_fresh_ratio(void volatile *addr, size_t len);
+void coverage_save(void);
+void coverage_report(void);
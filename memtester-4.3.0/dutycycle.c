@@ -0,0 +1,252 @@
+/*
+ * Duty cycle (load modulation) mode for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * Some marginal hardware only fails during the transitions between idle and
+ * full load (because of the power delivery and temperature changes), while
+ * memtester normally runs flat out.  In the duty cycle mode the tests are run
+ * slice by slice and the scheduler below decides before each slice whether
+ * to proceed or to idle for a while:
+ *
+ *   square:PERIOD[:DUTY]  - active for DUTY percent (50 by default) of each
+ *                           PERIOD seconds
+ *   ramp:PERIOD           - the load ramps up from 0% to 100% during each
+ *                           PERIOD seconds (using 1 second PWM windows)
+ *   burst:MEAN            - random active and idle periods, which are
+ *                           MEAN seconds long on average
+ *   rate:BYTES            - hold the memory traffic at BYTES per second
+ *                           (decimal K/M/G suffix, 10^3/10^6/10^9, or B
+ *                           for bytes, megabytes by default)
+ *
+ * The memory traffic is estimated from the number of bytes verified by
+ * compare_regions(), the same way as lima-memspeed uses byte counters.
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "types.h"
+#include "memtester.h"
+#include "dutycycle.h"
+
+#define DEFAULT_SLICE   (16 << 20)
+#define RAMP_WINDOW     1.0
+
+enum { DUTY_NONE, DUTY_SQUARE, DUTY_RAMP, DUTY_BURST, DUTY_RATE };
+
+static int mode = DUTY_NONE;
+static double period, duty = 0.5, burst_mean, target_rate;
+static size_t slice_bytes = DEFAULT_SLICE;
+
+static double start_time, last_time, last_transition, burst_end;
+static double active_time, idle_time;
+static int burst_active = 1;
+static ul transitions;
+static ull start_bytes;
+
+static double gettime(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 0.000000001 * t.tv_nsec;
+}
+
+static void sleep_for(double seconds) {
+    struct timespec t;
+    t.tv_sec = (time_t) seconds;
+    t.tv_nsec = (long) ((seconds - t.tv_sec) * 1000000000.);
+    nanosleep(&t, NULL);
+}
+
+/* The rate is in decimal units (like in lima-memspeed), so that it matches
+   the MB/s in the reports */
+static double parse_rate(const char *arg) {
+    char *suffix;
+    double rate;
+
+    rate = strtod(arg, &suffix);
+    if (suffix == arg) {
+        return -1;
+    }
+    switch (*suffix) {
+        case 'G':
+        case 'g':
+            rate *= 1e9;
+            break;
+        case 'M':
+        case 'm':
+        case '\0':
+            rate *= 1e6;
+            break;
+        case 'K':
+        case 'k':
+            rate *= 1e3;
+            break;
+        case 'B':
+        case 'b':
+            break;
+        default:
+            return -1;
+    }
+    if (*suffix && suffix[1] != '\0') {
+        return -1;
+    }
+    return rate;
+}
+
+int duty_cycle_init(const char *spec) {
+    const char *arg = strchr(spec, ':');
+    char *end, *env;
+
+    if (!arg) {
+        return -1;
+    }
+    arg++;
+    end = (char *) arg;
+    if (!strncmp(spec, "square:", 7)) {
+        mode = DUTY_SQUARE;
+        period = strtod(arg, &end);
+        if (*end == ':') {
+            duty = strtod(end + 1, &end) / 100;
+        }
+    } else if (!strncmp(spec, "ramp:", 5)) {
+        mode = DUTY_RAMP;
+        period = strtod(arg, &end);
+    } else if (!strncmp(spec, "burst:", 6)) {
+        mode = DUTY_BURST;
+        burst_mean = strtod(arg, &end);
+    } else if (!strncmp(spec, "rate:", 5)) {
+        mode = DUTY_RATE;
+        target_rate = parse_rate(arg);
+        if (target_rate <= 0) {
+            return -1;
+        }
+        end = "";
+    }
+    if (mode == DUTY_NONE || *end != '\0' || period < 0 || burst_mean < 0 ||
+        duty <= 0 || duty > 1 || ((mode == DUTY_SQUARE || mode == DUTY_RAMP)
+                                  && period == 0) ||
+        (mode == DUTY_BURST && burst_mean == 0)) {
+        mode = DUTY_NONE;
+        return -1;
+    }
+
+    if ((env = getenv("MEMTESTER_DUTY_SLICE"))) {
+        if (parse_mem_size(env, &slice_bytes) ||
+            slice_bytes < 2 * sizeof(ul)) {
+            fprintf(stderr, "error parsing MEMTESTER_DUTY_SLICE %s\n", env);
+            mode = DUTY_NONE;
+            return -1;
+        }
+    }
+
+    printf("duty cycle mode: %s, %lluKB slices\n", spec,
+           (ull) slice_bytes >> 10);
+    start_time = last_time = last_transition = gettime();
+    burst_end = start_time + burst_mean;
+    start_bytes = memtester_bytes_counter;
+    return 0;
+}
+
+int duty_cycle_enabled(void) {
+    return mode != DUTY_NONE;
+}
+
+size_t duty_cycle_slice_bytes(void) {
+    return slice_bytes;
+}
+
+/* How long to stay idle starting from time 't' (0 to keep running) */
+static double idle_needed(double t) {
+    double phase, level, ahead;
+
+    switch (mode) {
+        case DUTY_SQUARE:
+            phase = fmod(t - start_time, period);
+            return phase < duty * period ? 0 : period - phase;
+        case DUTY_RAMP:
+            level = fmod(t - start_time, period) / period;
+            phase = fmod(t - start_time, RAMP_WINDOW);
+            return phase < level * RAMP_WINDOW ? 0 : RAMP_WINDOW - phase;
+        case DUTY_BURST:
+            /* exponentially distributed active and idle periods */
+            while (t >= burst_end) {
+                burst_active = !burst_active;
+                burst_end += -burst_mean * log(1.0 - rand() /
+                                               (RAND_MAX + 1.0));
+            }
+            return burst_active ? 0 : burst_end - t;
+        case DUTY_RATE:
+            ahead = (memtester_bytes_counter - start_bytes) / target_rate -
+                    (t - start_time);
+            return ahead > 0 ? ahead : 0;
+    }
+    return 0;
+}
+
+void duty_cycle_wait(void) {
+    double t = gettime(), idle;
+
+    if (mode == DUTY_NONE) {
+        return;
+    }
+    active_time += t - last_time;
+    last_time = t;
+
+    idle = idle_needed(t);
+    if (idle <= 0) {
+        return;
+    }
+    sleep_for(idle);
+    t = gettime();
+    idle_time += t - last_time;
+    last_time = last_transition = t;
+    transitions++;
+}
+
+void duty_cycle_describe(FILE *f) {
+    double t = gettime(), level;
+
+    if (mode == DUTY_NONE) {
+        return;
+    }
+    fprintf(f, "  load phase: ");
+    switch (mode) {
+        case DUTY_SQUARE:
+            fprintf(f, "square wave %.1fs/%.0f%%", period, duty * 100);
+            break;
+        case DUTY_RAMP:
+            level = fmod(t - start_time, period) / period;
+            fprintf(f, "ramp %.1fs at %.0f%% load", period, level * 100);
+            break;
+        case DUTY_BURST:
+            fprintf(f, "random bursts of %.1fs", burst_mean);
+            break;
+        case DUTY_RATE:
+            fprintf(f, "rate %.0fMB/s (actual %.0fMB/s)", target_rate / 1e6,
+                    (memtester_bytes_counter - start_bytes) / 1e6 /
+                    (t - start_time));
+            break;
+    }
+    fprintf(f, ", active for %.3fs since the last idle period\n",
+            t - last_transition);
+}
+
+void duty_cycle_report(void) {
+    double total = active_time + idle_time;
+
+    if (mode == DUTY_NONE || total <= 0) {
+        return;
+    }
+    printf("  duty cycle: active %.0f%% of the time, %lu idle->active "
+           "transitions, %.0fMB/s average\n", active_time * 100 / total,
+           transitions, (memtester_bytes_counter - start_bytes) / 1e6 /
+           (gettime() - start_time));
+    fflush(stdout);
+}
@@ -0,0 +1,20 @@
+/*
+ * Duty cycle (load modulation) mode for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the duty cycle mode, which
+ * alternates between running the tests and idling, so that the hardware
+ * goes through many transitions between the idle and the full load.
+ *
+ */
+
+#include <stdio.h>
+
+int duty_cycle_init(const char *spec);
+int duty_cycle_enabled(void);
+size_t duty_cycle_slice_bytes(void);
+void duty_cycle_wait(void);
+void duty_cycle_describe(FILE *f);
+void duty_cycle_report(void);
@@ -0,0 +1,294 @@
+/*
+ * Elastic (memory pressure aware) test mode for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * Instead of locking one big buffer at startup, the elastic mode tests
+ * memory in independently mmap'ed and mlock'ed chunks.  Before each chunk
+ * is tested, the memory pressure in the system is checked (PSI from
+ * /proc/pressure/memory if the kernel has it, and MemAvailable from
+ * /proc/meminfo).  Chunks are released when the other processes need the
+ * memory and taken back once it is free again.  This allows to test
+ * "all free memory" on a live system without provoking the OOM killer.
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "types.h"
+#include "memtester.h"
+#include "elastic.h"
+#include "coverage.h"
+#include "dutycycle.h"
+#include "telemetry.h"
+
+/* Defaults, can be changed via MEMTESTER_ELASTIC_RESERVE (size with an
+   optional B/K/M/G suffix) and MEMTESTER_ELASTIC_PSI (percent). */
+#define DEFAULT_RESERVE     (64 << 20)
+#define DEFAULT_PSI_LIMIT   10.0
+
+/* With a coverage map, a new chunk which is mostly backed by the frames
+   tested before is put aside and another one is tried (at most this many
+   times), so that the never tested frames are preferred. */
+#define FRESH_RATIO_WANTED  0.5
+#define FRESH_RETRIES       4
+
+struct elastic_chunk {
+    void *addr;
+    size_t size;
+    ul passes;          /* completed runs of the test suite */
+};
+
+static struct elastic_chunk *chunks;
+static size_t nchunks, maxchunks, locked_bytes;
+static size_t reserve = DEFAULT_RESERVE;
+static double psi_limit = DEFAULT_PSI_LIMIT;
+static int do_mlock = 1;
+
+/* "some avg10" value from the PSI interface or -1 if not supported */
+static double read_psi_some_avg10(void) {
+    char line[256];
+    double avg10 = -1;
+    FILE *f = fopen("/proc/pressure/memory", "r");
+
+    if (!f) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "some avg10=%lf", &avg10) == 1) {
+            break;
+        }
+    }
+    fclose(f);
+    return avg10;
+}
+
+/* Available memory in bytes.  Kernels older than 3.14 have no MemAvailable
+   field, in which case it is estimated as MemFree + Buffers + Cached. */
+static ull read_mem_available(void) {
+    char line[256];
+    ull v, avail = 0, memfree = 0, buffers = 0, cached = 0;
+    int have_avail = 0;
+    FILE *f = fopen("/proc/meminfo", "r");
+
+    if (!f) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "MemAvailable: %llu", &v) == 1) {
+            avail = v;
+            have_avail = 1;
+        } else if (sscanf(line, "MemFree: %llu", &v) == 1) {
+            memfree = v;
+        } else if (sscanf(line, "Buffers: %llu", &v) == 1) {
+            buffers = v;
+        } else if (sscanf(line, "Cached: %llu", &v) == 1) {
+            cached = v;
+        }
+    }
+    fclose(f);
+    if (!have_avail) {
+        avail = memfree + buffers + cached;
+    }
+    return avail * 1024;
+}
+
+static void *map_chunk(size_t size) {
+    void *addr;
+
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+    if (do_mlock && mlock(addr, size) < 0) {
+        if (errno != EPERM) {
+            /* ENOMEM or EAGAIN: over the limit, try again later */
+            munmap(addr, size);
+            return NULL;
+        }
+        fprintf(stderr, "elastic: insufficient permission for mlock, "
+                "continuing with unlocked memory; testing will be slower "
+                "and less reliable.\n");
+        do_mlock = 0;
+    }
+    return addr;
+}
+
+static void unmap_chunk(void *addr, size_t size) {
+    if (do_mlock) {
+        munlock(addr, size);
+    }
+    munmap(addr, size);
+}
+
+static int acquire_chunk(size_t size, ull spare) {
+    void *addr, *rejected[FRESH_RETRIES];
+    int nrejected = 0;
+
+    if (nchunks == maxchunks) {
+        size_t newmax = maxchunks ? maxchunks * 2 : 16;
+        struct elastic_chunk *p = realloc(chunks, newmax * sizeof(*chunks));
+        if (!p) {
+            return -1;
+        }
+        chunks = p;
+        maxchunks = newmax;
+    }
+
+    addr = map_chunk(size);
+    /* Holding the rejected chunks must not eat into the reserve */
+    while (addr && coverage_enabled() && nrejected < FRESH_RETRIES &&
+           spare >= (ull) (nrejected + 1) * size &&
+           coverage_fresh_ratio(addr, size) < FRESH_RATIO_WANTED) {
+        rejected[nrejected++] = addr;
+        addr = map_chunk(size);
+    }
+    while (nrejected) {
+        unmap_chunk(rejected[--nrejected], size);
+    }
+    if (!addr) {
+        return -1;
+    }
+
+    chunks[nchunks].addr = addr;
+    chunks[nchunks].size = size;
+    chunks[nchunks].passes = 0;
+    nchunks++;
+    locked_bytes += size;
+    return 0;
+}
+
+static void release_chunk(void) {
+    struct elastic_chunk *c = &chunks[--nchunks];
+
+    unmap_chunk(c->addr, c->size);
+    locked_bytes -= c->size;
+}
+
+/* Release a chunk if the system is short on memory, otherwise grow
+   towards 'wantbytes' while keeping some hysteresis, so that the memory
+   is not given back again right after it has been taken. */
+static void elastic_adjust(size_t wantbytes, size_t chunksize,
+                           size_t pagesize) {
+    double psi = read_psi_some_avg10();
+    ull avail = read_mem_available();
+    size_t size;
+
+    if (psi > psi_limit || avail < reserve) {
+        if (nchunks) {
+            printf("  elastic: memory pressure (PSI ");
+            if (psi < 0) {
+                printf("n/a");
+            } else {
+                printf("%.1f%%", psi);
+            }
+            printf(", %lluMB available), releasing %lluMB\n", avail >> 20,
+                   (ull) chunks[nchunks - 1].size >> 20);
+            fflush(stdout);
+            release_chunk();
+        }
+        return;
+    }
+
+    while (locked_bytes < wantbytes && avail >= reserve + 2 * chunksize) {
+        size = wantbytes - locked_bytes;
+        if (size > chunksize) {
+            size = chunksize;
+        }
+        size &= ~(pagesize - 1);
+        if (!size || acquire_chunk(size, avail - reserve - 2 * chunksize)) {
+            break;
+        }
+        avail -= size;
+    }
+}
+
+int elastic_run(size_t wantbytes, size_t chunksize, size_t pagesize,
+                ul loops, ul testmask) {
+    char *env;
+    ul loop, minpasses, maxpasses;
+    ull tested, total_tested = 0;
+    size_t i;
+    int exit_code = 0;
+
+    if ((env = getenv("MEMTESTER_ELASTIC_RESERVE"))) {
+        if (parse_mem_size(env, &reserve)) {
+            fprintf(stderr, "error parsing MEMTESTER_ELASTIC_RESERVE %s\n",
+                    env);
+            return EXIT_FAIL_NONSTARTER;
+        }
+    }
+    if ((env = getenv("MEMTESTER_ELASTIC_PSI"))) {
+        psi_limit = strtod(env, NULL);
+    }
+
+    printf("elastic mode: %lluMB chunks, keeping %lluMB available, "
+           "PSI limit %.1f%%\n", (ull) chunksize >> 20, (ull) reserve >> 20,
+           psi_limit);
+
+    for (loop = 1; ((!loops) || loop <= loops); loop++) {
+        printf("Loop %lu", loop);
+        if (loops) {
+            printf("/%lu", loops);
+        }
+        printf(":\n");
+        fflush(stdout);
+
+        tested = 0;
+        for (i = 0; ; i++) {
+            elastic_adjust(wantbytes, chunksize, pagesize);
+            while (!nchunks) {
+                printf("  elastic: no memory available, waiting...\n");
+                fflush(stdout);
+                sleep(5);
+                elastic_adjust(wantbytes, chunksize, pagesize);
+            }
+            if (i >= nchunks) {
+                break;
+            }
+            printf(" Chunk %lu/%lu (%lluMB):\n", (ul) i + 1, (ul) nchunks,
+                   (ull) chunks[i].size >> 20);
+            fflush(stdout);
+            exit_code |= memtester_run_tests(chunks[i].addr, chunks[i].size,
+                                             testmask);
+            chunks[i].passes++;
+            tested += chunks[i].size;
+            coverage_mark(chunks[i].addr, chunks[i].size);
+        }
+        total_tested += tested;
+
+        minpasses = maxpasses = chunks[0].passes;
+        for (i = 1; i < nchunks; i++) {
+            if (chunks[i].passes < minpasses) {
+                minpasses = chunks[i].passes;
+            }
+            if (chunks[i].passes > maxpasses) {
+                maxpasses = chunks[i].passes;
+            }
+        }
+        printf("  elastic: tested %lluMB in this loop (%lluMB in total), "
+               "%lluMB held in %lu chunks, %lu..%lu passes per chunk\n",
+               tested >> 20, total_tested >> 20, (ull) locked_bytes >> 20,
+               (ul) nchunks, minpasses, maxpasses);
+        coverage_save();
+        coverage_report();
+        duty_cycle_report();
+        telemetry_report();
+        printf("\n");
+        fflush(stdout);
+    }
+
+    while (nchunks) {
+        release_chunk();
+    }
+    free(chunks);
+    return exit_code;
+}
@@ -0,0 +1,14 @@
+/*
+ * Elastic (memory pressure aware) test mode for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the elastic mode, which tests
+ * memory in independently locked chunks and releases or reacquires them
+ * depending on the memory pressure in the system.
+ *
+ */
+
+int elastic_run(size_t wantbytes, size_t chunksize, size_t pagesize,
+                unsigned long loops, unsigned long testmask);
@@ -24,14 +24,21 @@
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 
 #include "types.h"
 #include "sizes.h"
 #include "tests.h"
-
-#define EXIT_FAIL_NONSTARTER    0x01
-#define EXIT_FAIL_ADDRESSLINES  0x02
-#define EXIT_FAIL_OTHERTEST     0x04
+#include "memtester.h"
+#include "elastic.h"
+#include "coverage.h"
+#include "cpu_placement.h"
+#include "dutycycle.h"
+#include "cacheflush.h"
+#include "patterns.h"
+#include "workers.h"
+#include "telemetry.h"
+#include "perf_counters.h"
 
 struct test tests[] = {
     { "Random Value", test_random_value },
@@ -49,13 +56,15 @@ struct test tests[] = {
     { "Solid Bits", test_solidbits_comparison },
     { "Walking Ones", test_walkbits1_comparison },
     { "Walking Zeroes", test_walkbits0_comparison },
-#ifdef TEST_NARROW_WRITES    
     { "8-bit Writes", test_8bit_wide_random },
     { "16-bit Writes", test_16bit_wide_random },
-#endif
+    { "Pointer Chase", test_pointer_chase },
     { NULL, NULL }
 };
 
+/* The built-in tests followed by the patterns loaded with -P */
+static struct test *test_list = tests;
+
 /* Sanity checks and portability helper macros. */
 #ifdef _SC_VERSION
 void check_posix_system(void) {
@@ -98,24 +107,209 @@ void usage(char *me);
 /* Global vars - so tests have access to this information */
 int use_phys = 0;
 int memtester_early_exit = 0;
+int memtester_cache_flush = 0;
 off_t physaddrbase = 0;
 
 /* Function definitions */
 void usage(char *me) {
     fprintf(stderr, "\n"
-            "Usage: %s [-p physaddrbase [-d device]] <mem>[B|K|M|G] [loops]\n",
+            "Usage: %s [-p physaddrbase [-d device]] [-e chunksize[B|K|M|G]]\n"
+            "           [-c coverage_map] [-a cpulist] [-n node]\n"
+            "           [-D dutycycle] [-L L1|L2|L3|size|full]\n"
+            "           [-P patternfile] [-w workers] [-T seconds] [-H]\n"
+            "           <mem>[B|K|M|G] [loops]\n",
             me);
     exit(EXIT_FAIL_NONSTARTER);
 }
 
+/* Parse a size argument with an optional B/K/M/G suffix (megabytes if
+   no suffix is given).  Returns 0 on success. */
+int parse_mem_size(const char *arg, size_t *bytes) {
+    char *suffix;
+    size_t raw;
+    int shift;
+
+    errno = 0;
+    raw = (size_t) strtoul(arg, &suffix, 0);
+    if (errno != 0 || suffix == arg) {
+        return -1;
+    }
+    switch (*suffix) {
+        case 'G':
+        case 'g':
+            shift = 30;
+            break;
+        case 'M':
+        case 'm':
+        case '\0':
+            shift = 20;
+            break;
+        case 'K':
+        case 'k':
+            shift = 10;
+            break;
+        case 'B':
+        case 'b':
+            shift = 0;
+            break;
+        default:
+            return -1;
+    }
+    if (*suffix && suffix[1] != '\0') {
+        return -1;
+    }
+    *bytes = raw << shift;
+    return 0;
+}
+
+/* Print what is known about the conditions at the time of a failure */
+void memtester_failure_context(void) {
+    workers_describe(stderr);
+    duty_cycle_describe(stderr);
+    telemetry_describe(stderr);
+}
+
+/* Amount of memory (bufa and bufb together) passed to each test at once
+   in the duty cycle and cache chunk modes, 0 for the whole buffer */
+static size_t slice_bytes = 0;
+/* Show how long each test took */
+static int show_timing = 0;
+/* Count the hardware events of each test (-H), the counters are opened
+   by the first memtester_run_tests() call of each process */
+static int use_perf_counters = 0;
+static perf_counters_t perf;
+static pid_t perf_pid = 0;
+
+static double gettime(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 0.000000001 * t.tv_nsec;
+}
+
+static int call_test(struct test *t, ulv *bufa, ulv *bufb, size_t count) {
+    if (t->data) {
+        return t->fp(t->data, bufa, bufb, count);
+    }
+    return t->fp(bufa, bufb, count);
+}
+
+/* Run a single test over the buffer halves, possibly slice by slice.  In
+   the duty cycle mode there is a chance to idle before each slice. */
+static int run_test(struct test *t, ulv *bufa, ulv *bufb, size_t count) {
+    size_t offset, slice, n;
+    int result = 0;
+
+    if (!slice_bytes) {
+        return call_test(t, bufa, bufb, count);
+    }
+    slice = slice_bytes / 2 / sizeof(ul);
+    for (offset = 0; offset < count && !result; offset += n) {
+        n = count - offset < slice ? count - offset : slice;
+        duty_cycle_wait();
+        memtester_region_offset = offset * sizeof(ul);
+        result = call_test(t, bufa + offset, bufb + offset, n);
+    }
+    memtester_region_offset = 0;
+    return result;
+}
+
+static void print_ok(double start) {
+    if (show_timing) {
+        printf("ok (%.3fs)\n", gettime() - start);
+    } else {
+        printf("ok\n");
+    }
+}
+
+static void perf_start(perf_snapshot_t *start) {
+    if (!use_perf_counters) {
+        return;
+    }
+    if (perf_pid != getpid()) {
+        perf_counters_init(&perf);
+        perf_counters_open(&perf);
+        perf_pid = getpid();
+    }
+    perf_counters_read(&perf, start);
+}
+
+/* The misses are per KB of the tested memory */
+static void perf_print(const perf_snapshot_t *start, size_t bytes) {
+    uint64_t delta[PERF_EVENTS];
+    perf_snapshot_t end;
+
+    if (!use_perf_counters) {
+        return;
+    }
+    perf_counters_read(&perf, &end);
+    perf_counters_delta(delta, start, &end);
+    printf("  %-20s  ", "");
+    perf_counters_print(stdout, delta, bytes);
+}
+
+static int stuck_address_helper(ulv *bufa, ulv *unused, size_t count) {
+    return test_stuck_address(bufa, count);
+}
+
+static struct test stuck_address = { "Stuck Address", stuck_address_helper };
+
+/* Run the whole test suite once over the buffer and return the exit
+   code bits for the failed tests. */
+int memtester_run_tests(void volatile *aligned, size_t bufsize, ul testmask) {
+    size_t halflen, count;
+    ulv *bufa, *bufb;
+    int exit_code = 0;
+    double start;
+    perf_snapshot_t perf_values;
+    ul i;
+
+    halflen = bufsize / 2;
+    count = halflen / sizeof(ul);
+    bufa = (ulv *) aligned;
+    bufb = (ulv *) ((size_t) aligned + halflen);
+
+    if (!getenv("MEMTESTER_SKIP_STUCK_ADDRESS")) {
+        printf("  %-20s: ", stuck_address.name);
+        fflush(stdout);
+        start = gettime();
+        perf_start(&perf_values);
+        if (!run_test(&stuck_address, aligned, NULL,
+                      bufsize / sizeof(ul))) {
+            print_ok(start);
+        } else {
+            exit_code |= EXIT_FAIL_ADDRESSLINES;
+        }
+        perf_print(&perf_values, bufsize);
+    }
+    for (i=0;;i++) {
+        if (!test_list[i].name) break;
+        /* If using a custom testmask, only run this test if the
+           bit corresponding to this test was set by the user.
+         */
+        if (testmask && (i >= UL_LEN || !((1UL << i) & testmask))) {
+            continue;
+        }
+        printf("  %-20s: ", test_list[i].name);
+        start = gettime();
+        perf_start(&perf_values);
+        if (!run_test(&test_list[i], bufa, bufb, count)) {
+            print_ok(start);
+        } else {
+            exit_code |= EXIT_FAIL_OTHERTEST;
+        }
+        perf_print(&perf_values, bufsize);
+        fflush(stdout);
+    }
+    return exit_code;
+}
+
 int memtester_main(int argc, char **argv) {
-    ul loops, loop, i;
+    ul loops, loop;
     size_t pagesize, wantraw, wantmb, wantbytes, wantbytes_orig, bufsize,
-         halflen, count;
+         chunksize = 0, chunkbytes = 0;
     char *memsuffix, *addrsuffix, *loopsuffix;
     ptrdiff_t pagesizemask;
     void volatile *buf, *aligned;
-    ulv *bufa, *bufb;
     int do_mlock = 1, done_mem = 0;
     int exit_code = 0;
     int memfd, opt, memshift;
@@ -126,6 +320,13 @@ int memtester_main(int argc, char **argv) {
     struct stat statbuf;
     int device_specified = 0;
     char *env_testmask = 0;
+    char *coverage_map = NULL;
+    char *cpulist = NULL;
+    char *dutycycle = NULL;
+    char *cache_chunk = NULL;
+    long numa_node = -1;
+    long nworkers = 0;
+    double telemetry_interval = 1.0;
     ul testmask = 0;
 
     printf("memtester version " __version__ " (%d-bit)\n", UL_LEN);
@@ -136,6 +337,7 @@ int memtester_main(int argc, char **argv) {
     pagesize = memtester_pagesize();
     pagesizemask = (ptrdiff_t) ~(pagesize - 1);
     printf("pagesizemask is 0x%tx\n", pagesizemask);
+    print_cpu_topology();
 
     if (getenv("MEMTESTER_EARLY_EXIT"))
         memtester_early_exit = 1;
@@ -154,7 +356,7 @@ int memtester_main(int argc, char **argv) {
         printf("using testmask 0x%lx\n", testmask);
     }
 
-    while ((opt = getopt(argc, argv, "p:d:")) != -1) {
+    while ((opt = getopt(argc, argv, "p:d:e:c:a:n:D:L:P:w:T:H")) != -1) {
         switch (opt) {
             case 'p':
                 errno = 0;
@@ -197,6 +399,65 @@ int memtester_main(int argc, char **argv) {
                     }
                 }
                 break;              
+            case 'e':
+                if (parse_mem_size(optarg, &chunksize) ||
+                    chunksize < pagesize) {
+                    fprintf(stderr, "failed to parse elastic chunk size\n");
+                    usage(argv[0]); /* doesn't return */
+                }
+                chunksize &= pagesizemask;
+                break;
+            case 'c':
+                coverage_map = optarg;
+                break;
+            case 'a':
+                if (cpu_list_count(optarg) <= 0) {
+                    fprintf(stderr, "failed to parse cpu list %s\n", optarg);
+                    usage(argv[0]); /* doesn't return */
+                }
+                cpulist = optarg;
+                break;
+            case 'n':
+                errno = 0;
+                numa_node = strtol(optarg, &addrsuffix, 0);
+                if (errno != 0 || *addrsuffix != '\0' || numa_node < 0) {
+                    fprintf(stderr, "failed to parse NUMA node %s\n", optarg);
+                    usage(argv[0]); /* doesn't return */
+                }
+                break;
+            case 'D':
+                dutycycle = optarg;
+                break;
+            case 'L':
+                cache_chunk = optarg;
+                break;
+            case 'P':
+                if (patterns_load(optarg, test_list, &test_list)) {
+                    usage(argv[0]); /* doesn't return */
+                }
+                break;
+            case 'w':
+                errno = 0;
+                nworkers = strtol(optarg, &addrsuffix, 0);
+                if (errno != 0 || *addrsuffix != '\0' || nworkers < 1 ||
+                    nworkers > MAX_WORKERS) {
+                    fprintf(stderr, "failed to parse number of workers %s\n",
+                            optarg);
+                    usage(argv[0]); /* doesn't return */
+                }
+                break;
+            case 'T':
+                telemetry_interval = strtod(optarg, &addrsuffix);
+                if (*addrsuffix != '\0' || telemetry_interval < 0 ||
+                    (telemetry_interval > 0 && telemetry_interval < 0.01)) {
+                    fprintf(stderr, "failed to parse telemetry interval %s\n",
+                            optarg);
+                    usage(argv[0]); /* doesn't return */
+                }
+                break;
+            case 'H':
+                use_perf_counters = 1;
+                break;
             default: /* '?' */
                 usage(argv[0]); /* doesn't return */
         }
@@ -271,9 +532,116 @@ int memtester_main(int argc, char **argv) {
         }
     }
 
+    if (chunksize && use_phys) {
+        fprintf(stderr, "elastic mode (-e) can't be used together with -p\n");
+        usage(argv[0]); /* doesn't return */
+    }
+
+    if (nworkers && (use_phys || chunksize || coverage_map)) {
+        fprintf(stderr, "worker mode (-w) can't be used together with -p, "
+                "-e or -c\n");
+        usage(argv[0]); /* doesn't return */
+    }
+
+    if (coverage_map && use_phys) {
+        fprintf(stderr, "coverage map (-c) can't be used together with -p\n");
+        usage(argv[0]); /* doesn't return */
+    }
+    if (coverage_map) {
+        coverage_init(coverage_map, pagesize);
+    }
+
+    /* started before pinning, the sampler doesn't need to share the cpus
+       with the tests */
+    if (telemetry_interval > 0) {
+        telemetry_start(telemetry_interval);
+    }
+
+    if (use_perf_counters) {
+        perf_counters_init(&perf);
+        if (!perf_counters_open(&perf)) {
+            fprintf(stderr, "hardware performance counters are not "
+                    "available: %s\n", strerror(errno));
+            use_perf_counters = 0;
+        }
+        perf_counters_close(&perf);
+    }
+
+    if (cpulist && pin_current_thread(cpulist, -1) == 0) {
+        printf("pinned to cpus %s\n", cpulist);
+    }
+    if (numa_node >= numa_node_count()) {
+        fprintf(stderr, "NUMA node %ld does not exist\n", numa_node);
+        exit(EXIT_FAIL_NONSTARTER);
+    }
+    /* Binding to the only node is pointless, and would just fail on
+       kernels without NUMA support. */
+    if (numa_node >= 0 && numa_node_count() > 1 &&
+        numa_bind_thread_memory(numa_node) == 0) {
+        printf("allocating memory on NUMA node %ld\n", numa_node);
+    }
+
+    if (dutycycle && duty_cycle_init(dutycycle)) {
+        fprintf(stderr, "failed to parse duty cycle %s\n", dutycycle);
+        usage(argv[0]); /* doesn't return */
+    }
+    if (duty_cycle_enabled()) {
+        slice_bytes = duty_cycle_slice_bytes();
+    }
+
+    if (cache_chunk) {
+        show_timing = 1;
+        if (!strcmp(cache_chunk, "full")) {
+            chunkbytes = 0;
+        } else if ((cache_chunk[0] == 'L' || cache_chunk[0] == 'l') &&
+                   cache_chunk[1] >= '1' && cache_chunk[1] <= '4' &&
+                   cache_chunk[2] == '\0') {
+            chunkbytes = cpu_cache_size(cache_chunk[1] - '0');
+            if (!chunkbytes) {
+                fprintf(stderr, "size of the %s cache is unknown\n",
+                        cache_chunk);
+                exit(EXIT_FAIL_NONSTARTER);
+            }
+        } else if (parse_mem_size(cache_chunk, &chunkbytes) ||
+                   chunkbytes < 2 * sizeof(ul)) {
+            fprintf(stderr, "failed to parse cache chunk size %s\n",
+                    cache_chunk);
+            usage(argv[0]); /* doesn't return */
+        }
+        if (chunkbytes) {
+            if (cache_flush_init()) {
+                fprintf(stderr, "failed to allocate cache eviction buffer\n");
+                exit(EXIT_FAIL_NONSTARTER);
+            }
+            memtester_cache_flush = 1;
+            if (!slice_bytes || chunkbytes < slice_bytes) {
+                slice_bytes = chunkbytes;
+            }
+            printf("cache chunk mode: testing %lluKB at once\n",
+                   (ull) slice_bytes >> 10);
+        }
+    }
+
     printf("want %lluMB (%llu bytes)\n", (ull) wantmb, (ull) wantbytes);
     buf = NULL;
 
+    if (nworkers) {
+        exit_code = workers_run(nworkers, wantbytes, pagesize, loops,
+                                testmask, cpulist);
+        telemetry_report();
+        printf("Done.\n");
+        fflush(stdout);
+        exit(exit_code);
+    }
+
+    if (chunksize) {
+        exit_code = elastic_run(wantbytes, chunksize, pagesize, loops,
+                                testmask);
+        printf("Done.\n");
+        fflush(stdout);
+        exit(exit_code);
+    }
+
     if (use_phys) {
         memfd = open(device_name, O_RDWR | O_SYNC);
         if (memfd == -1) {
@@ -363,11 +731,6 @@ int memtester_main(int argc, char **argv) {
     if (!do_mlock) fprintf(stderr, "Continuing with unlocked memory; testing "
                            "will be slower and less reliable.\n");
 
-    halflen = bufsize / 2;
-    count = halflen / sizeof(ul);
-    bufa = (ulv *) aligned;
-    bufb = (ulv *) ((size_t) aligned + halflen);
-
     for(loop=1; ((!loops) || loop <= loops); loop++) {
         printf("Loop %lu", loop);
         if (loops) {
@@ -375,31 +738,14 @@ int memtester_main(int argc, char **argv) {
         }
         printf(":\n");
         fflush(stdout);
-        if (!getenv("MEMTESTER_SKIP_STUCK_ADDRESS")) {
-            printf("  %-20s: ", "Stuck Address");
-            fflush(stdout);
-            if (!test_stuck_address(aligned, bufsize / sizeof(ul))) {
-                printf("ok\n");
-            } else {
-                exit_code |= EXIT_FAIL_ADDRESSLINES;
-            }
-        }
-        for (i=0;;i++) {
-            if (!tests[i].name) break;
-            /* If using a custom testmask, only run this test if the
-               bit corresponding to this test was set by the user.
-             */
-            if (testmask && (!((1 << i) & testmask))) {
-                continue;
-            }
-            printf("  %-20s: ", tests[i].name);
-            if (!tests[i].fp(bufa, bufb, count)) {
-                printf("ok\n");
-            } else {
-                exit_code |= EXIT_FAIL_OTHERTEST;
-            }
-            fflush(stdout);
+        exit_code |= memtester_run_tests(aligned, bufsize, testmask);
+        if (coverage_enabled()) {
+            coverage_mark(aligned, bufsize);
+            coverage_save();
+            coverage_report();
         }
+        duty_cycle_report();
+        telemetry_report();
         printf("\n");
         fflush(stdout);
     }
@@ -15,9 +15,24 @@
 
 #include <sys/types.h>
 
+#define EXIT_FAIL_NONSTARTER    0x01
+#define EXIT_FAIL_ADDRESSLINES  0x02
+#define EXIT_FAIL_OTHERTEST     0x04
+
 /* extern declarations. */
 
 extern int use_phys;
 extern off_t physaddrbase;
 extern int memtester_early_exit;
+extern int memtester_has_found_errors;
+extern int memtester_cache_flush;
+extern size_t memtester_region_offset;
+extern unsigned long long memtester_bytes_counter;
+
+/* helpers from the main file, used by the optional test modes */
+
+int parse_mem_size(const char *arg, size_t *bytes);
+int memtester_run_tests(void volatile *aligned, size_t bufsize,
+                        unsigned long testmask);
+void memtester_failure_context(void);
 
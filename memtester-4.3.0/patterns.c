@@ -0,0 +1,479 @@
+/*
+ * User defined data patterns for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * Additional test patterns can be loaded from a file (see the -P option),
+ * one pattern per line:
+ *
+ *   NAME words WORD... [repeat R] [stride S] [iterations N]
+ *   NAME expr EXPRESSION [iterations N]
+ *
+ * A "words" pattern fills the memory with the list of 64-bit words, each
+ * of them repeated R times.  On every iteration the list is shifted by S
+ * words (1 by default), so by default every word lands in every location.
+ * An "expr" pattern computes the value of each word from its index 'i' and
+ * the iteration number 'n' using the C operators + - * / % & | ^ ~ << >>
+ * and parentheses.  Everything after '#' is a comment.
+ *
+ * The patterns are expanded at startup: a words pattern into a table which
+ * is just copied to the memory, an expression into bytecode which operates
+ * on whole blocks of words at once, so that the interpretation overhead is
+ * negligible.
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "types.h"
+#include "tests.h"
+#include "memtester.h"
+#include "patterns.h"
+
+#define MAX_LINE        4096
+#define MAX_CODE        256
+#define MAX_DEPTH       16
+#define EXPR_BLOCK      256
+
+enum { PATTERN_WORDS, PATTERN_EXPR };
+
+enum {
+    OP_CONST, OP_I, OP_N, OP_NEG, OP_NOT,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_AND, OP_OR, OP_XOR,
+    OP_SHL, OP_SHR
+};
+
+struct insn {
+    int op;
+    ull value;
+};
+
+struct pattern {
+    char *name;
+    int kind;
+    ul iterations;
+    /* words */
+    ul *table;
+    size_t tablelen, stride;
+    /* expr */
+    struct insn code[MAX_CODE];
+    int codelen;
+};
+
+/* Recursive descent compiler of the expressions into the stack based
+   bytecode, the usual C operator precedence applies */
+struct compiler {
+    const char *s;
+    struct pattern *p;
+    int depth, maxdepth, error;
+};
+
+static void emit(struct compiler *c, int op, ull value) {
+    if (c->p->codelen == MAX_CODE) {
+        c->error = 1;
+        return;
+    }
+    c->p->code[c->p->codelen].op = op;
+    c->p->code[c->p->codelen].value = value;
+    c->p->codelen++;
+    if (op <= OP_N) {
+        if (++c->depth > c->maxdepth) {
+            c->maxdepth = c->depth;
+        }
+    } else if (op >= OP_ADD) {
+        c->depth--;
+    }
+}
+
+static void skip_spaces(struct compiler *c) {
+    while (isspace((unsigned char) *c->s)) {
+        c->s++;
+    }
+}
+
+static void parse_or(struct compiler *c);
+
+static void parse_unary(struct compiler *c) {
+    char *end;
+
+    skip_spaces(c);
+    if (*c->s == '-' || *c->s == '~') {
+        int op = *c->s++ == '-' ? OP_NEG : OP_NOT;
+        parse_unary(c);
+        emit(c, op, 0);
+    } else if (*c->s == '(') {
+        c->s++;
+        parse_or(c);
+        skip_spaces(c);
+        if (*c->s++ != ')') {
+            c->error = 1;
+        }
+    } else if (*c->s == 'i' || *c->s == 'n') {
+        emit(c, *c->s++ == 'i' ? OP_I : OP_N, 0);
+    } else if (isdigit((unsigned char) *c->s)) {
+        emit(c, OP_CONST, strtoull(c->s, &end, 0));
+        c->s = end;
+    } else {
+        c->error = 1;
+    }
+}
+
+/* Parse a chain of binary operators, 'ops' are the characters of the
+   operators of this precedence level ('<' and '>' stand for the shifts) */
+static void parse_binary(struct compiler *c, const char *ops,
+                         void (*next)(struct compiler *c)) {
+    static const char all_ops[] = "+-*/%&|^<>";
+    static const int opcodes[] = { OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD,
+                                   OP_AND, OP_OR, OP_XOR, OP_SHL, OP_SHR };
+    char op;
+
+    next(c);
+    while (!c->error) {
+        skip_spaces(c);
+        op = *c->s;
+        if (!op || !strchr(ops, op)) {
+            return;
+        }
+        if (op == '<' || op == '>') {
+            if (c->s[1] != op) {
+                c->error = 1;
+                return;
+            }
+            c->s++;
+        }
+        c->s++;
+        next(c);
+        emit(c, opcodes[strchr(all_ops, op) - all_ops], 0);
+    }
+}
+
+static void parse_mul(struct compiler *c) {
+    parse_binary(c, "*/%", parse_unary);
+}
+
+static void parse_add(struct compiler *c) {
+    parse_binary(c, "+-", parse_mul);
+}
+
+static void parse_shift(struct compiler *c) {
+    parse_binary(c, "<>", parse_add);
+}
+
+static void parse_and(struct compiler *c) {
+    parse_binary(c, "&", parse_shift);
+}
+
+static void parse_xor(struct compiler *c) {
+    parse_binary(c, "^", parse_and);
+}
+
+static void parse_or(struct compiler *c) {
+    parse_binary(c, "|", parse_xor);
+}
+
+static int compile_expr(struct pattern *p, const char *s) {
+    struct compiler c = { s, p, 0, 0, 0 };
+
+    parse_or(&c);
+    skip_spaces(&c);
+    if (c.error || *c.s || c.maxdepth > MAX_DEPTH) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Evaluate the expression for the words first..first+len-1.  Every
+   instruction processes the whole block, so that the dispatch overhead
+   is paid once per block and the loops can be vectorized. */
+static void eval_block(struct pattern *p, ul first, ul n, size_t len,
+                       ul *out) {
+    static ull stack[MAX_DEPTH][EXPR_BLOCK];
+    ull *a, *b;
+    int pc, sp = 0;
+    size_t k;
+
+    for (pc = 0; pc < p->codelen; pc++) {
+        struct insn *in = &p->code[pc];
+        if (in->op <= OP_N) {
+            b = stack[sp++];
+            for (k = 0; k < len; k++) {
+                b[k] = in->op == OP_CONST ? in->value :
+                       in->op == OP_I ? first + k : n;
+            }
+            continue;
+        }
+        if (in->op >= OP_ADD) {
+            /* binary operators: a = a op b, with b on the top */
+            sp--;
+        }
+        a = stack[sp - 1];
+        b = stack[sp];
+        switch (in->op) {
+            case OP_NEG:
+                for (k = 0; k < len; k++) {
+                    a[k] = -a[k];
+                }
+                break;
+            case OP_NOT:
+                for (k = 0; k < len; k++) {
+                    a[k] = ~a[k];
+                }
+                break;
+            case OP_ADD:
+                for (k = 0; k < len; k++) {
+                    a[k] += b[k];
+                }
+                break;
+            case OP_SUB:
+                for (k = 0; k < len; k++) {
+                    a[k] -= b[k];
+                }
+                break;
+            case OP_MUL:
+                for (k = 0; k < len; k++) {
+                    a[k] *= b[k];
+                }
+                break;
+            case OP_DIV:
+                for (k = 0; k < len; k++) {
+                    a[k] = b[k] ? a[k] / b[k] : 0;
+                }
+                break;
+            case OP_MOD:
+                for (k = 0; k < len; k++) {
+                    a[k] = b[k] ? a[k] % b[k] : 0;
+                }
+                break;
+            case OP_AND:
+                for (k = 0; k < len; k++) {
+                    a[k] &= b[k];
+                }
+                break;
+            case OP_OR:
+                for (k = 0; k < len; k++) {
+                    a[k] |= b[k];
+                }
+                break;
+            case OP_XOR:
+                for (k = 0; k < len; k++) {
+                    a[k] ^= b[k];
+                }
+                break;
+            case OP_SHL:
+                for (k = 0; k < len; k++) {
+                    a[k] <<= b[k] & 63;
+                }
+                break;
+            case OP_SHR:
+                for (k = 0; k < len; k++) {
+                    a[k] >>= b[k] & 63;
+                }
+                break;
+        }
+    }
+    for (k = 0; k < len; k++) {
+        out[k] = (ul) stack[0][k];
+    }
+}
+
+static int test_pattern(struct pattern *p, ulv *bufa, ulv *bufb,
+                        size_t count) {
+    ul block[EXPR_BLOCK], n, first = memtester_region_offset / sizeof(ul);
+    ulv *p1, *p2;
+    size_t i, j, k, len;
+
+    putchar(' ');
+    fflush(stdout);
+    for (n = 0; n < p->iterations; n++) {
+        putchar('\b');
+        putchar("-\\|/"[n % 4]);
+        fflush(stdout);
+        p1 = bufa;
+        p2 = bufb;
+        if (p->kind == PATTERN_WORDS) {
+            /* the same position in the table for the same word index,
+               even when the memory is tested slice by slice */
+            j = (first + n * p->stride) % p->tablelen;
+            for (i = 0; i < count; i++) {
+                *p1++ = *p2++ = p->table[j];
+                if (++j == p->tablelen) {
+                    j = 0;
+                }
+            }
+        } else {
+            for (i = 0; i < count; i += len) {
+                len = count - i < EXPR_BLOCK ? count - i : EXPR_BLOCK;
+                eval_block(p, first + i, n, len, block);
+                for (k = 0; k < len; k++) {
+                    *p1++ = *p2++ = block[k];
+                }
+            }
+        }
+        if (compare_regions(p->name, bufa, bufb, count)) {
+            return -1;
+        }
+    }
+    printf("\b \b");
+    fflush(stdout);
+    return 0;
+}
+
+static size_t gcd(size_t a, size_t b) {
+    while (b) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* Parse "words" pattern arguments, on 32-bit systems each 64-bit word
+   takes two table entries (in the native byte order) */
+static int parse_words(struct pattern *p, char *args) {
+    char *tok, *end, *saveptr;
+    ull words[MAX_LINE / 2];
+    size_t nwords = 0, repeat = 1, stride = 1, w, r, k;
+    int have_iterations = 0;
+    union {
+        ull val;
+        ul parts[sizeof(ull) / sizeof(ul)];
+    } word;
+
+    for (tok = strtok_r(args, " \t", &saveptr); tok;
+         tok = strtok_r(NULL, " \t", &saveptr)) {
+        if (!strcmp(tok, "repeat") || !strcmp(tok, "stride") ||
+            !strcmp(tok, "iterations")) {
+            char *key = tok;
+            ul value;
+            tok = strtok_r(NULL, " \t", &saveptr);
+            if (!tok) {
+                return -1;
+            }
+            value = strtoul(tok, &end, 0);
+            if (*end || !value) {
+                return -1;
+            }
+            if (key[0] == 'r') {
+                repeat = value;
+            } else if (key[0] == 's') {
+                stride = value;
+            } else {
+                p->iterations = value;
+                have_iterations = 1;
+            }
+            continue;
+        }
+        words[nwords++] = strtoull(tok, &end, 0);
+        if (*end) {
+            return -1;
+        }
+    }
+    if (!nwords) {
+        return -1;
+    }
+
+    k = sizeof(ull) / sizeof(ul);
+    p->tablelen = nwords * repeat * k;
+    p->table = malloc(p->tablelen * sizeof(ul));
+    if (!p->table) {
+        return -1;
+    }
+    p->stride = stride * repeat * k;
+    for (w = 0; w < nwords; w++) {
+        word.val = words[w];
+        for (r = 0; r < repeat; r++) {
+            memcpy(&p->table[(w * repeat + r) * k], word.parts, sizeof(ull));
+        }
+    }
+    if (!have_iterations) {
+        p->iterations = p->tablelen / gcd(p->tablelen,
+                                          p->stride % p->tablelen);
+    }
+    return 0;
+}
+
+int patterns_load(const char *filename, struct test *builtin,
+                  struct test **list) {
+    char line[MAX_LINE], *s, *name, *kind, *args, *it;
+    struct test *tests;
+    struct pattern *p;
+    int nbuiltin, ntests, lineno = 0;
+    FILE *f = fopen(filename, "r");
+
+    if (!f) {
+        perror(filename);
+        return -1;
+    }
+    for (nbuiltin = 0; builtin[nbuiltin].name; nbuiltin++);
+    tests = malloc((nbuiltin + 1) * sizeof(struct test));
+    if (!tests) {
+        fclose(f);
+        return -1;
+    }
+    memcpy(tests, builtin, nbuiltin * sizeof(struct test));
+    ntests = nbuiltin;
+
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        if ((s = strchr(line, '#'))) {
+            *s = '\0';
+        }
+        name = strtok_r(line, " \t\n", &s);
+        if (!name) {
+            continue;
+        }
+        kind = strtok_r(NULL, " \t\n", &s);
+        args = strtok_r(NULL, "\n", &s);
+        p = calloc(1, sizeof(*p));
+        tests = realloc(tests, (ntests + 2) * sizeof(struct test));
+        if (!p || !tests || !kind || !args) {
+            goto error;
+        }
+        p->name = strdup(name);
+        p->iterations = 1;
+        if (!strcmp(kind, "words")) {
+            p->kind = PATTERN_WORDS;
+            if (parse_words(p, args)) {
+                goto error;
+            }
+        } else if (!strcmp(kind, "expr")) {
+            p->kind = PATTERN_EXPR;
+            if ((it = strstr(args, "iterations"))) {
+                *it = '\0';
+                p->iterations = strtoul(it + strlen("iterations"), &s, 0);
+                while (isspace((unsigned char) *s)) {
+                    s++;
+                }
+                if (*s || !p->iterations) {
+                    goto error;
+                }
+            }
+            if (compile_expr(p, args)) {
+                goto error;
+            }
+        } else {
+            goto error;
+        }
+        tests[ntests].name = p->name;
+        tests[ntests].fp = test_pattern;
+        tests[ntests].data = p;
+        ntests++;
+    }
+    fclose(f);
+    tests[ntests].name = NULL;
+    tests[ntests].fp = NULL;
+    tests[ntests].data = NULL;
+    printf("loaded %d patterns from %s\n", ntests - nbuiltin, filename);
+    *list = tests;
+    return 0;
+
+error:
+    fprintf(stderr, "%s:%d: invalid pattern\n", filename, lineno);
+    fclose(f);
+    return -1;
+}
@@ -0,0 +1,16 @@
+/*
+ * User defined data patterns for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for loading the additional test
+ * patterns from a file.
+ *
+ */
+
+/* Load the patterns and make '*list' point to a new test list, which has
+   them appended to the 'builtin' tests (possibly the list from an earlier
+   call).  Returns 0 on success. */
+int patterns_load(const char *filename, struct test *builtin,
+                  struct test **list);
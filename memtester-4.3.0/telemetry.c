@@ -0,0 +1,302 @@
+/*
+ * Thermal and clock telemetry for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * A background thread periodically samples the temperatures from
+ * /sys/class/thermal, the cpu clock frequencies from cpufreq and the
+ * frequencies of the devfreq devices (usually the DRAM controller and the
+ * GPU) into a ring.  Every failure is reported together with the most
+ * recent sample, and the time spent in each temperature band is reported
+ * after each loop.  Only the nodes which exist on the host are used, they
+ * are opened once and then just re-read with pread(), so the sampling is
+ * cheap.  The ring lives in a shared mapping, so that the worker processes
+ * (see -w) see the samples too.
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "types.h"
+#include "telemetry.h"
+
+#define MAX_SOURCES     16
+#define RING_SAMPLES    256
+#define BAND_WIDTH      10      /* degrees */
+#define MAX_BANDS       16
+
+enum { SOURCE_THERMAL, SOURCE_CPUFREQ, SOURCE_DEVFREQ };
+
+struct source {
+    int kind;
+    int fd;
+    char name[32];
+};
+
+struct sample {
+    double time;
+    long values[MAX_SOURCES];
+};
+
+struct telemetry_ring {
+    volatile unsigned int count;
+    struct sample samples[RING_SAMPLES];
+    double band_time[MAX_BANDS];
+    long max_temp;
+};
+
+static struct source sources[MAX_SOURCES];
+static int nsources, have_thermal;
+static double interval;
+static struct telemetry_ring *ring;
+
+static double gettime(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 0.000000001 * t.tv_nsec;
+}
+
+static void add_source(int kind, const char *path, const char *name) {
+    int fd;
+
+    if (nsources == MAX_SOURCES) {
+        return;
+    }
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    sources[nsources].kind = kind;
+    sources[nsources].fd = fd;
+    snprintf(sources[nsources].name, sizeof(sources[nsources].name), "%s",
+             name);
+    nsources++;
+    if (kind == SOURCE_THERMAL) {
+        have_thermal = 1;
+    }
+}
+
+static int read_line(const char *path, char *buf, size_t size) {
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        return -1;
+    }
+    if (!fgets(buf, size, f)) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+static void find_sources(void) {
+    char path[300], name[64];
+    struct dirent *de;
+    DIR *dir;
+    int cpu;
+
+    if ((dir = opendir("/sys/class/thermal"))) {
+        while ((de = readdir(dir))) {
+            if (strncmp(de->d_name, "thermal_zone", 12)) {
+                continue;
+            }
+            snprintf(path, sizeof(path), "/sys/class/thermal/%s/type",
+                     de->d_name);
+            if (read_line(path, name, sizeof(name))) {
+                snprintf(name, sizeof(name), "%.63s", de->d_name);
+            }
+            snprintf(path, sizeof(path), "/sys/class/thermal/%s/temp",
+                     de->d_name);
+            add_source(SOURCE_THERMAL, path, name);
+        }
+        closedir(dir);
+    }
+
+    /* one source per cpufreq policy (the first cpu of the related ones) */
+    for (cpu = 0; cpu < 256; cpu++) {
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%d/cpufreq/related_cpus", cpu);
+        if (read_line(path, name, sizeof(name))) {
+            continue;
+        }
+        if (strtol(name, NULL, 10) != cpu) {
+            continue;
+        }
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq",
+                 cpu);
+        snprintf(name, sizeof(name), "cpu%d", cpu);
+        add_source(SOURCE_CPUFREQ, path, name);
+    }
+
+    if ((dir = opendir("/sys/class/devfreq"))) {
+        while ((de = readdir(dir))) {
+            if (de->d_name[0] == '.') {
+                continue;
+            }
+            snprintf(path, sizeof(path), "/sys/class/devfreq/%s/cur_freq",
+                     de->d_name);
+            add_source(SOURCE_DEVFREQ, path, de->d_name);
+        }
+        closedir(dir);
+    }
+}
+
+static long read_source(struct source *s) {
+    char buf[32];
+    ssize_t len = pread(s->fd, buf, sizeof(buf) - 1, 0);
+    long value;
+
+    if (len <= 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+    value = strtol(buf, NULL, 10);
+    /* some old kernels report the temperature in degrees */
+    if (s->kind == SOURCE_THERMAL && value > 0 && value < 200) {
+        value *= 1000;
+    }
+    return value;
+}
+
+static void *sampler_thread(void *arg) {
+    struct timespec delay;
+    struct sample *smp;
+    long temp;
+    int i, band;
+
+    (void) arg;
+    delay.tv_sec = (time_t) interval;
+    delay.tv_nsec = (long) ((interval - delay.tv_sec) * 1000000000.);
+    while (1) {
+        smp = &ring->samples[ring->count % RING_SAMPLES];
+        smp->time = gettime();
+        temp = -1;
+        for (i = 0; i < nsources; i++) {
+            smp->values[i] = read_source(&sources[i]);
+            if (sources[i].kind == SOURCE_THERMAL &&
+                smp->values[i] > temp) {
+                temp = smp->values[i];
+            }
+        }
+        __sync_synchronize();
+        ring->count++;
+
+        if (temp >= 0) {
+            band = temp / 1000 / BAND_WIDTH;
+            if (band >= MAX_BANDS) {
+                band = MAX_BANDS - 1;
+            }
+            ring->band_time[band] += interval;
+            if (temp > ring->max_temp) {
+                ring->max_temp = temp;
+            }
+        }
+        nanosleep(&delay, NULL);
+    }
+    return NULL;
+}
+
+int telemetry_start(double seconds) {
+    pthread_t thread;
+    int i;
+
+    interval = seconds;
+    find_sources();
+    if (!nsources) {
+        return -1;
+    }
+    ring = mmap(NULL, sizeof(*ring), PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        ring = NULL;
+        return -1;
+    }
+    if (pthread_create(&thread, NULL, sampler_thread, NULL)) {
+        munmap(ring, sizeof(*ring));
+        ring = NULL;
+        return -1;
+    }
+    pthread_detach(thread);
+
+    printf("telemetry: sampling every %gs:", interval);
+    for (i = 0; i < nsources; i++) {
+        printf(" %s", sources[i].name);
+    }
+    printf("\n");
+    return 0;
+}
+
+void telemetry_describe(FILE *f) {
+    struct sample smp;
+    unsigned int count;
+    int i;
+
+    if (!ring || !(count = ring->count)) {
+        return;
+    }
+    __sync_synchronize();
+    smp = ring->samples[(count - 1) % RING_SAMPLES];
+    fprintf(f, "  telemetry %.1fs ago:", gettime() - smp.time);
+    for (i = 0; i < nsources; i++) {
+        if (smp.values[i] < 0) {
+            continue;
+        }
+        switch (sources[i].kind) {
+            case SOURCE_THERMAL:
+                fprintf(f, " %s %.1fC", sources[i].name,
+                        smp.values[i] / 1000.);
+                break;
+            case SOURCE_CPUFREQ:
+                fprintf(f, " %s %ldMHz", sources[i].name,
+                        smp.values[i] / 1000);
+                break;
+            case SOURCE_DEVFREQ:
+                fprintf(f, " %s %ldMHz", sources[i].name,
+                        smp.values[i] / 1000000);
+                break;
+        }
+    }
+    fprintf(f, "\n");
+}
+
+void telemetry_report(void) {
+    double total = 0;
+    int band;
+
+    if (!ring || !have_thermal) {
+        return;
+    }
+    for (band = 0; band < MAX_BANDS; band++) {
+        total += ring->band_time[band];
+    }
+    if (total <= 0) {
+        return;
+    }
+    printf("  telemetry: max %.1fC, time spent at", ring->max_temp / 1000.);
+    for (band = 0; band < MAX_BANDS; band++) {
+        if (ring->band_time[band] <= 0) {
+            continue;
+        }
+        if (band == MAX_BANDS - 1) {
+            printf(" %d+C", band * BAND_WIDTH);
+        } else {
+            printf(" %d-%dC", band * BAND_WIDTH, (band + 1) * BAND_WIDTH);
+        }
+        printf(" %.0f%%", ring->band_time[band] * 100 / total);
+    }
+    printf("\n");
+    fflush(stdout);
+}
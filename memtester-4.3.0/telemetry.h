@@ -0,0 +1,16 @@
+/*
+ * Thermal and clock telemetry for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the background sampler of the
+ * temperatures and clock frequencies.
+ *
+ */
+
+#include <stdio.h>
+
+int telemetry_start(double seconds);
+void telemetry_describe(FILE *f);
+void telemetry_report(void);
@@ -17,10 +17,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <time.h>
 
 #include "types.h"
 #include "sizes.h"
 #include "memtester.h"
+#include "cacheflush.h"
 
 char progress[] = "-\\|/";
 #define PROGRESSLEN 4
@@ -31,6 +33,13 @@ char progress[] = "-\\|/";
 
 int memtester_has_found_errors = 0;
 
+/* Offset of the buffers passed to the tests (when the memory is tested
+   slice by slice), used for reporting the failed addresses */
+size_t memtester_region_offset = 0;
+
+/* Estimated memory traffic (writing and reading back both buffers) */
+ull memtester_bytes_counter = 0;
+
 #ifdef __arm__
 typedef struct compare_regions_helper_result {
     ul failed_index[8];
@@ -107,13 +116,20 @@ int compare_regions(const char *tname, ulv *bufa, ulv *bufb, size_t count) {
     ul crc1, crc2;
     ul write_error = 1;
 
+    memtester_bytes_counter += 4 * count * sizeof(ul);
+    if (memtester_cache_flush) {
+        cache_flush(bufa, count * sizeof(ul));
+        cache_flush(bufb, count * sizeof(ul));
+    }
     index1 = compare_regions_helper(bufa, bufb, count, &v1a, &v1b, &crc1);
     if (index1 == (size_t)(-1))
         return 0;
+    index1 += memtester_region_offset / sizeof(ul);
 
     /* additional passes to confirm if the results are the same */
     for (i = 0; i < 32; i++) {
         index2 = compare_regions_helper(bufa, bufb, count, &v2a, &v2b, &crc2);
+        index2 += memtester_region_offset / sizeof(ul);
         if (index1 != index2 || crc1 != crc2) {
             write_error = 0;
             break;
@@ -134,6 +150,7 @@ int compare_regions(const char *tname, ulv *bufa, ulv *bufb, size_t count) {
                 write_error ? "WRITE" : "READ",
                 v1a, v1b, (ul)(index1 * sizeof(ul)), tname);
     }
+    memtester_failure_context();
     fflush(stderr);
     fsync(fileno(stderr));
     if (memtester_early_exit)
@@ -163,9 +180,13 @@ int test_stuck_address(ulv *bufa, size_t count) {
         printf("\b\b\b\b\b\b\b\b\b\b\b");
         printf("testing %3u", j);
         fflush(stdout);
+        if (memtester_cache_flush) {
+            cache_flush(bufa, count * sizeof(ul));
+        }
         p1 = (ulv *) bufa;
         for (i = 0; i < count; i++, p1++) {
             if (*p1 != (((j + i) % 2) == 0 ? (ul) p1 : ~((ul) p1))) {
+                i += memtester_region_offset / sizeof(ul);
                 if (use_phys) {
                     physaddr = physaddrbase + (i * sizeof(ul));
                     fprintf(stderr, 
@@ -178,6 +199,7 @@ int test_stuck_address(ulv *bufa, size_t count) {
                             "0x%08lx.\n", 
                             (ul) (i * sizeof(ul)));
                 }
+                memtester_failure_context();
                 printf("Skipping to next test...\n");
                 fflush(stdout);
                 return -1;
@@ -533,37 +555,83 @@ int test_bitflip_comparison(ulv *bufa, ulv *bufb, size_t count) {
     return 0;
 }
 
-#ifdef TEST_NARROW_WRITES    
-int test_8bit_wide_random(ulv* bufa, ulv* bufb, size_t count) {
-    u8v *p1, *t;
-    ulv *p2;
-    int attempt;
-    unsigned int b, j = 0;
-    size_t i;
+/* The narrow write tests fill the memory using genuine 8-bit and 16-bit
+   stores.  The memory is processed in batches: each batch is first filled
+   with the expected data in bufb (or bufa) and with its complement in the
+   other buffer using full width writes.  The batch is then written back and
+   evicted from the caches, and every byte (or halfword) lane of the
+   complement is overwritten with the expected data, striding across the
+   cache lines.  A store which gets lost or goes to the wrong byte lane
+   leaves the complement bits behind and is detected by compare_regions.
+
+   Without the eviction, the narrow stores would just be merged into the
+   lines in the write-back cache and DRAM would only ever see full line
+   writebacks.  Even so, the caches which allocate lines on write merge the
+   narrow stores into a line read back from DRAM, so the byte lane write
+   masks (DM/DQM) are only really exercised on the CPUs without the write
+   allocation, or reliably with an uncached mapping (-p). */
+#define NARROW_BATCH_WORDS ((1024 * 1024) / sizeof(ul))
+#define NARROW_LINE_WORDS (64 / sizeof(ul))
+
+/* rand_ul() is too slow to keep up with the byte stores */
+static ull xorshift64(ull *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int test_narrow_wide_random(ulv *bufa, ulv *bufb, size_t count,
+                                   size_t width, char *tname) {
+    ulv *p1, *p2;
+    ull state = rand_ul() | 1;
+    int attempt, evict = cache_flush_init() == 0;
+    unsigned int lane, lanes = sizeof(ul) / width, j = 0;
+    size_t i, w, n, batch;
+    ul v;
 
     putchar(' ');
     fflush(stdout);
-    for (attempt = 0; attempt < 2;  attempt++) {
+    for (attempt = 0; attempt < 2; attempt++) {
         if (attempt & 1) {
-            p1 = (u8v *) bufa;
+            p1 = bufa;
             p2 = bufb;
         } else {
-            p1 = (u8v *) bufb;
+            p1 = bufb;
             p2 = bufa;
         }
-        for (i = 0; i < count; i++) {
-            t = mword8.bytes;
-            *p2++ = mword8.val = rand_ul();
-            for (b=0; b < UL_LEN/8; b++) {
-                *p1++ = *t++;
+        for (batch = 0; batch < count; batch += n) {
+            n = count - batch < NARROW_BATCH_WORDS ? count - batch :
+                NARROW_BATCH_WORDS;
+            for (i = 0; i < n; i++) {
+                v = (ul) xorshift64(&state);
+                p2[batch + i] = v;
+                p1[batch + i] = ~v;
+            }
+            if (evict) {
+                cache_flush(p1 + batch, n * sizeof(ul));
+            }
+            for (lane = 0; lane < lanes; lane++) {
+                for (w = 0; w < NARROW_LINE_WORDS; w++) {
+                    for (i = batch + w; i < batch + n;
+                         i += NARROW_LINE_WORDS) {
+                        if (width == 1) {
+                            ((u8v *) (p1 + i))[lane] =
+                                ((u8v *) (p2 + i))[lane];
+                        } else {
+                            ((u16v *) (p1 + i))[lane] =
+                                ((u16v *) (p2 + i))[lane];
+                        }
+                    }
+                }
             }
-            if (!(i % PROGRESSOFTEN)) {
+            if (batch / PROGRESSOFTEN != (batch + n) / PROGRESSOFTEN) {
                 putchar('\b');
                 putchar(progress[++j % PROGRESSLEN]);
                 fflush(stdout);
             }
         }
-        if (compare_regions("8bit_wide_random", bufa, bufb, count)) {
+        if (compare_regions(tname, bufa, bufb, count)) {
             return -1;
         }
     }
@@ -572,41 +640,176 @@ int test_8bit_wide_random(ulv* bufa, ulv* bufb, size_t count) {
     return 0;
 }
 
+int test_8bit_wide_random(ulv* bufa, ulv* bufb, size_t count) {
+    return test_narrow_wide_random(bufa, bufb, count, 1, "8bit_wide_random");
+}
+
 int test_16bit_wide_random(ulv* bufa, ulv* bufb, size_t count) {
-    u16v *p1, *t;
-    ulv *p2;
-    int attempt;
-    unsigned int b, j = 0;
-    size_t i;
+    return test_narrow_wide_random(bufa, bufb, count, 2, "16bit_wide_random");
+}
 
-    putchar( ' ' );
-    fflush( stdout );
-    for (attempt = 0; attempt < 2; attempt++) {
-        if (attempt & 1) {
-            p1 = (u16v *) bufa;
-            p2 = bufb;
-        } else {
-            p1 = (u16v *) bufb;
-            p2 = bufa;
+/* Random access test.  The buffer is turned into CHASE_CHAINS interleaved
+   random cyclic permutations (Sattolo's algorithm), where every cell holds
+   the address of the next cell of its chain, and bufb gets a copy.  The
+   chains are then walked in lockstep, each one for its own length, so that
+   the memory controller has several independent requests in flight.  The
+   prefetchers can't predict the accesses, so the DRAM pages are constantly
+   opened and closed.  Groups of CHASE_GROUP steps are timed, recording the
+   visited values, which are only checked against the copy after the clock
+   is stopped.  A corrupted pointer is redirected to the start of the buffer
+   rather than dereferenced. */
+#define CHASE_CHAINS 8
+#define CHASE_GROUP 4
+#define CHASE_HIST_NS 2048
+
+static double chase_gettime(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000. + t.tv_nsec;
+}
+
+int test_pointer_chase(ulv* bufa, ulv* bufb, size_t count) {
+    ulv *p[CHASE_CHAINS], *prev[CHASE_CHAINS];
+    ul v, t, lo, span, rec[CHASE_GROUP][CHASE_CHAINS];
+    ul hist[CHASE_HIST_NS] = { 0 };
+    ull state = rand_ul() | 1;
+    size_t chains, len, steps, i, k, n, step, loads, groups = 0, idx;
+    double start, now, ns, overhead, total_ns = 0, max_ns = 0;
+    unsigned int c, active, j = 0;
+    off_t physaddr;
+
+    chains = count < CHASE_CHAINS ? count : CHASE_CHAINS;
+    if (!chains) {
+        return 0;
+    }
+    putchar(' ');
+    fflush(stdout);
+
+    /* chain c is made of the cells c, c + chains, c + 2 * chains, ... */
+    for (c = 0; c < chains; c++) {
+        len = (count - c + chains - 1) / chains;
+        for (k = 0; k < len; k++) {
+            bufa[c + k * chains] = c + k * chains;
         }
-        for (i = 0; i < count; i++) {
-            t = mword16.u16s;
-            *p2++ = mword16.val = rand_ul();
-            for (b = 0; b < UL_LEN/16; b++) {
-                *p1++ = *t++;
+        for (k = len - 1; k > 0; k--) {
+            i = xorshift64(&state) % k;
+            t = bufa[c + k * chains];
+            bufa[c + k * chains] = bufa[c + i * chains];
+            bufa[c + i * chains] = t;
+        }
+    }
+    for (i = 0; i < count; i++) {
+        bufb[i] = bufa[i] = (ul) &bufa[bufa[i]];
+    }
+
+    /* the clock_gettime() cost is taken out of the timed groups */
+    overhead = CHASE_HIST_NS;
+    for (i = 0; i < 16; i++) {
+        start = chase_gettime();
+        now = chase_gettime();
+        if (now - start < overhead) {
+            overhead = now - start;
+        }
+    }
+
+    /* The first count % chains chains are one cell longer than the rest */
+    len = count / chains;
+    steps = len + (count % chains ? 1 : 0);
+    lo = (ul) bufa;
+    span = count * sizeof(ul);
+    for (c = 0; c < chains; c++) {
+        p[c] = &bufa[c];
+    }
+    for (step = 0; step < steps; step += n) {
+        n = steps - step < CHASE_GROUP ? steps - step : CHASE_GROUP;
+        for (c = 0; c < chains; c++) {
+            prev[c] = p[c];
+        }
+        start = chase_gettime();
+        for (k = 0; k < n; k++) {
+            active = step + k < len ? chains : count % chains;
+            for (c = 0; c < active; c++) {
+                v = *p[c];
+                rec[k][c] = v;
+                p[c] = (ulv *) (v - lo < span ? v : lo);
             }
-            if (!(i % PROGRESSOFTEN)) {
-                putchar('\b');
-                putchar(progress[++j % PROGRESSLEN]);
-                fflush(stdout);
+        }
+        now = chase_gettime();
+
+        loads = 0;
+        for (k = 0; k < n; k++) {
+            active = step + k < len ? chains : count % chains;
+            for (c = 0; c < active; c++, loads++) {
+                idx = prev[c] - bufa;
+                v = rec[k][c];
+                prev[c] = (ulv *) v;
+                t = bufb[idx];
+                if (v == t) {
+                    continue;
+                }
+                idx += memtester_region_offset / sizeof(ul);
+                memtester_has_found_errors = 1;
+                if (use_phys) {
+                    physaddr = physaddrbase + (ul)(idx * sizeof(ul));
+                    fprintf(stderr,
+                            "READ FAILURE: 0x%08lx != 0x%08lx at "
+                            "physical address 0x%08lx (pointer_chase).\n",
+                            v, t, physaddr);
+                } else {
+                    fprintf(stderr,
+                            "READ FAILURE: 0x%08lx != 0x%08lx at offset "
+                            "0x%08lx (pointer_chase).\n",
+                            v, t, (ul)(idx * sizeof(ul)));
+                }
+                memtester_failure_context();
+                fflush(stderr);
+                if (memtester_early_exit)
+                    exit(4);
+                return -1;
             }
         }
-        if (compare_regions("16bit_wide_random", bufa, bufb, count)) {
+
+        ns = now - start > overhead ? (now - start - overhead) / loads : 0;
+        total_ns += ns * loads;
+        if (ns > max_ns) {
+            max_ns = ns;
+        }
+        hist[ns < CHASE_HIST_NS ? (size_t) ns : CHASE_HIST_NS - 1]++;
+        groups++;
+        if (step / PROGRESSOFTEN != (step + n) / PROGRESSOFTEN) {
+            putchar('\b');
+            putchar(progress[++j % PROGRESSLEN]);
+            fflush(stdout);
+        }
+    }
+    memtester_bytes_counter += 2 * count * sizeof(ul);
+    if (compare_regions("pointer_chase", bufa, bufb, count)) {
+        return -1;
+    }
+
+    /* Every chain is a single cycle, so the walks end where they started */
+    for (c = 0; c < chains; c++) {
+        if (p[c] != &bufa[c]) {
+            memtester_has_found_errors = 1;
+            fprintf(stderr, "FAILURE: chain %u of pointer_chase didn't "
+                    "return to its start.\n", c);
+            memtester_failure_context();
+            fflush(stderr);
+            if (memtester_early_exit)
+                exit(4);
             return -1;
         }
     }
-    printf("\b \b");
+
+    /* The time per load, with the chains' loads overlapping */
+    for (i = 0, n = 0; i < CHASE_HIST_NS - 1; i++) {
+        n += hist[i];
+        if (n * 100 >= groups * 99) {
+            break;
+        }
+    }
+    printf("\b avg %.0fns, p99 %luns, max %.0fns per load ",
+           total_ns / count, (ul) i, max_ns);
     fflush(stdout);
     return 0;
 }
-#endif
@@ -23,6 +23,7 @@ typedef unsigned short volatile u16v;
 struct test {
     char *name;
     int (*fp)();
+    void *data;     /* passed as the first argument to fp if not NULL */
 };
 
 union {
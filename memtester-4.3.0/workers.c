@@ -0,0 +1,253 @@
+/*
+ * Multi-process worker mode for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * Normally a single process owns all the tested memory, so one SIGBUS
+ * caused by an uncorrectable memory error ends the whole run, and all the
+ * page faults go through a single address space.  In the worker mode the
+ * memtester process becomes a supervisor, which forks the workers.  Each
+ * worker maps and locks its own slice of the memory and runs the test
+ * suite on it, reporting the results through a single producer / single
+ * consumer ring in a shared mapping (its stdout with the progress output
+ * goes to /dev/null, the failures are still printed to stderr).  A crashed
+ * worker is restarted and gets freshly allocated memory.
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "types.h"
+#include "memtester.h"
+#include "workers.h"
+#include "cpu_placement.h"
+
+#define RING_SIZE       64
+#define MAX_RESTARTS    10
+
+enum { MSG_STARTED, MSG_LOOP_DONE };
+
+struct worker_msg {
+    int type;
+    int exit_code;
+    ul loop;
+    ull bytes;
+};
+
+struct worker_ring {
+    volatile unsigned int head;     /* only written by the worker */
+    volatile unsigned int tail;     /* only written by the supervisor */
+    struct worker_msg msgs[RING_SIZE];
+};
+
+struct worker {
+    pid_t pid;
+    ul loops_done;
+    int restarts;
+};
+
+static int worker_id = -1;
+
+static void ring_push(struct worker_ring *r, int type, ul loop,
+                      int exit_code, ull bytes) {
+    struct worker_msg *m;
+
+    while (r->head - r->tail == RING_SIZE) {
+        usleep(1000);
+    }
+    m = &r->msgs[r->head % RING_SIZE];
+    m->type = type;
+    m->loop = loop;
+    m->exit_code = exit_code;
+    m->bytes = bytes;
+    __sync_synchronize();
+    r->head++;
+}
+
+static int ring_pop(struct worker_ring *r, struct worker_msg *m) {
+    if (r->tail == r->head) {
+        return 0;
+    }
+    __sync_synchronize();
+    *m = r->msgs[r->tail % RING_SIZE];
+    __sync_synchronize();
+    r->tail++;
+    return 1;
+}
+
+static void worker_main(struct worker_ring *r, size_t bytes, ul first_loop,
+                        ul loops, ul testmask, const char *cpulist) {
+    void *buf;
+    ul loop;
+    int fd;
+
+    /* don't outlive the supervisor */
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    fd = open("/dev/null", O_WRONLY);
+    if (fd >= 0) {
+        dup2(fd, STDOUT_FILENO);
+        close(fd);
+    }
+    if (cpulist) {
+        pin_current_thread(cpulist, worker_id);
+    }
+
+    buf = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+        fprintf(stderr, "worker %d: failed to allocate %lluMB\n", worker_id,
+                (ull) bytes >> 20);
+        exit(EXIT_FAIL_NONSTARTER);
+    }
+    if (mlock(buf, bytes) < 0) {
+        fprintf(stderr, "worker %d: failed to mlock, continuing with "
+                "unlocked memory\n", worker_id);
+    }
+    ring_push(r, MSG_STARTED, 0, 0, bytes);
+
+    for (loop = first_loop; ((!loops) || loop <= loops); loop++) {
+        ring_push(r, MSG_LOOP_DONE, loop,
+                  memtester_run_tests(buf, bytes, testmask), bytes);
+    }
+    exit(0);
+}
+
+static pid_t start_worker(int id, struct worker_ring *r, size_t bytes,
+                          ul first_loop, ul loops, ul testmask,
+                          const char *cpulist) {
+    pid_t pid;
+
+    r->head = r->tail = 0;
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    if (pid == 0) {
+        worker_id = id;
+        worker_main(r, bytes, first_loop, loops, testmask, cpulist);
+    }
+    if (pid < 0) {
+        perror("fork");
+    }
+    return pid;
+}
+
+static void drain_ring(int id, struct worker_ring *r, struct worker *w,
+                       ul loops, int *exit_code) {
+    struct worker_msg m;
+
+    while (ring_pop(r, &m)) {
+        if (m.type == MSG_STARTED) {
+            printf("  worker %d: testing %lluMB\n", id, m.bytes >> 20);
+            continue;
+        }
+        w->loops_done = m.loop;
+        printf("  worker %d: loop %lu", id, m.loop);
+        if (loops) {
+            printf("/%lu", loops);
+        }
+        printf(" %s\n", m.exit_code ? "FAILED" : "ok");
+        if (m.exit_code) {
+            memtester_has_found_errors = 1;
+            *exit_code |= m.exit_code;
+        }
+    }
+    fflush(stdout);
+}
+
+int workers_run(int nworkers, size_t wantbytes, size_t pagesize, ul loops,
+                ul testmask, const char *cpulist) {
+    struct worker_ring *rings;
+    struct worker *workers;
+    size_t bytes = (wantbytes / nworkers) & ~(pagesize - 1);
+    int i, status, running = 0, exit_code = 0;
+    pid_t pid;
+
+    rings = mmap(NULL, nworkers * sizeof(*rings), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    workers = calloc(nworkers, sizeof(*workers));
+    if (rings == MAP_FAILED || !workers || !bytes) {
+        fprintf(stderr, "failed to set up %d workers\n", nworkers);
+        return EXIT_FAIL_NONSTARTER;
+    }
+
+    printf("worker mode: %d workers, %lluMB each\n", nworkers,
+           (ull) bytes >> 20);
+    for (i = 0; i < nworkers; i++) {
+        workers[i].pid = start_worker(i, &rings[i], bytes, 1, loops,
+                                      testmask, cpulist);
+        if (workers[i].pid > 0) {
+            running++;
+        }
+    }
+
+    while (running) {
+        for (i = 0; i < nworkers; i++) {
+            drain_ring(i, &rings[i], &workers[i], loops, &exit_code);
+        }
+        pid = waitpid(-1, &status, WNOHANG);
+        if (pid <= 0) {
+            usleep(100000);
+            continue;
+        }
+        for (i = 0; i < nworkers && workers[i].pid != pid; i++);
+        if (i == nworkers) {
+            continue;
+        }
+        drain_ring(i, &rings[i], &workers[i], loops, &exit_code);
+        workers[i].pid = 0;
+        running--;
+
+        if (WIFEXITED(status)) {
+            exit_code |= WEXITSTATUS(status);
+            if (WEXITSTATUS(status) && memtester_early_exit) {
+                break;
+            }
+            continue;
+        }
+        /* SIGBUS from an uncorrectable error or a corrupted pointer */
+        memtester_has_found_errors = 1;
+        exit_code |= EXIT_FAIL_OTHERTEST;
+        printf("  worker %d: killed by signal %d (%s)", i,
+               WTERMSIG(status), strsignal(WTERMSIG(status)));
+        if (memtester_early_exit || workers[i].restarts == MAX_RESTARTS ||
+            (loops && workers[i].loops_done >= loops)) {
+            printf("\n");
+            continue;
+        }
+        workers[i].restarts++;
+        printf(", restarting (%d/%d)\n", workers[i].restarts, MAX_RESTARTS);
+        workers[i].pid = start_worker(i, &rings[i], bytes,
+                                      workers[i].loops_done + 1, loops,
+                                      testmask, cpulist);
+        if (workers[i].pid > 0) {
+            running++;
+        }
+    }
+
+    for (i = 0; i < nworkers; i++) {
+        if (workers[i].pid > 0) {
+            kill(workers[i].pid, SIGKILL);
+            waitpid(workers[i].pid, NULL, 0);
+        }
+    }
+    free(workers);
+    munmap(rings, nworkers * sizeof(*rings));
+    return exit_code;
+}
+
+void workers_describe(FILE *f) {
+    if (worker_id >= 0) {
+        fprintf(f, "  in worker %d (pid %d)\n", worker_id, (int) getpid());
+    }
+}
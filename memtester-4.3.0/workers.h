@@ -0,0 +1,19 @@
+/*
+ * Multi-process worker mode for memtester.
+ *
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the worker mode, where the tested
+ * memory is split between several forked worker processes.
+ *
+ */
+
+#include <stdio.h>
+
+#define MAX_WORKERS 256
+
+int workers_run(int nworkers, size_t wantbytes, size_t pagesize,
+                unsigned long loops, unsigned long testmask,
+                const char *cpulist);
+void workers_describe(FILE *f);
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Hardware performance counters via perf_event_open. Each event is opened
+ * separately (not as a group), so that a PMU with only a few counters
+ * still gets all of them through multiplexing, and an event which is not
+ * supported does not take the others down with it. The kernel mode is
+ * excluded, which is allowed for the normal users with the default
+ * perf_event_paranoid setting.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perf_counters.h"
+
+#define CACHE_EVENT(cache, result) \
+	((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | ((result) << 16))
+
+/* The architected BUS_ACCESS event of the ARM PMUs */
+#define ARM_BUS_ACCESS 0x19
+
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} events[PERF_EVENTS] = {
+	[PERF_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	[PERF_INSTRUCTIONS] = { PERF_TYPE_HARDWARE,
+				PERF_COUNT_HW_INSTRUCTIONS },
+	[PERF_L1D_MISSES] = { PERF_TYPE_HW_CACHE,
+			      CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D,
+					  PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	[PERF_LLC_MISSES] = { PERF_TYPE_HW_CACHE,
+			      CACHE_EVENT(PERF_COUNT_HW_CACHE_LL,
+					  PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	[PERF_DTLB_MISSES] = { PERF_TYPE_HW_CACHE,
+			       CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB,
+					   PERF_COUNT_HW_CACHE_RESULT_MISS) },
+#if defined(__arm__) || defined(__aarch64__)
+	[PERF_BUS_ACCESSES] = { PERF_TYPE_RAW, ARM_BUS_ACCESS },
+#else
+	/* there is no generic bus access event, the bus cycles are close */
+	[PERF_BUS_ACCESSES] = { PERF_TYPE_HARDWARE,
+				PERF_COUNT_HW_BUS_CYCLES },
+#endif
+};
+
+const char *const perf_event_names[PERF_EVENTS] = {
+	[PERF_CYCLES] = "cycles",
+	[PERF_INSTRUCTIONS] = "instructions",
+	[PERF_L1D_MISSES] = "l1d_misses",
+	[PERF_LLC_MISSES] = "llc_misses",
+	[PERF_DTLB_MISSES] = "dtlb_misses",
+	[PERF_BUS_ACCESSES] = "bus_accesses",
+};
+
+void perf_counters_init(perf_counters_t *pc)
+{
+	int i;
+	for (i = 0; i < PERF_EVENTS; i++)
+		pc->fd[i] = -1;
+}
+
+int perf_counters_open(perf_counters_t *pc)
+{
+	struct perf_event_attr attr;
+	int i, n = 0, err = 0;
+
+	for (i = 0; i < PERF_EVENTS; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = events[i].type;
+		attr.config = events[i].config;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+				   PERF_FORMAT_TOTAL_TIME_RUNNING;
+		pc->fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if (pc->fd[i] < 0) {
+			err = errno;
+			pc->fd[i] = -1;
+			continue;
+		}
+		n++;
+	}
+	if (!n)
+		errno = err;
+	return n;
+}
+
+void perf_counters_close(perf_counters_t *pc)
+{
+	int i;
+	for (i = 0; i < PERF_EVENTS; i++) {
+		if (pc->fd[i] >= 0)
+			close(pc->fd[i]);
+		pc->fd[i] = -1;
+	}
+}
+
+void perf_counters_read(const perf_counters_t *pc, perf_snapshot_t *s)
+{
+	/* value, time enabled, time running */
+	uint64_t buf[3];
+	int i;
+
+	for (i = 0; i < PERF_EVENTS; i++) {
+		if (pc->fd[i] < 0 ||
+		    read(pc->fd[i], buf, sizeof(buf)) != sizeof(buf)) {
+			s->value[i] = PERF_VALUE_NONE;
+			s->enabled[i] = s->running[i] = 0;
+			continue;
+		}
+		s->value[i] = buf[0];
+		s->enabled[i] = buf[1];
+		s->running[i] = buf[2];
+	}
+}
+
+/*
+ * The scaling has to be done on the deltas: the ratio of the cumulative
+ * times changes as the events get scheduled in and out, so the difference
+ * of two cumulatively scaled counts is wrong and can even be negative.
+ */
+void perf_counters_delta(uint64_t *delta, const perf_snapshot_t *start,
+			 const perf_snapshot_t *end)
+{
+	uint64_t value, enabled, running;
+	int i;
+
+	for (i = 0; i < PERF_EVENTS; i++) {
+		delta[i] = PERF_VALUE_NONE;
+		if (start->value[i] == PERF_VALUE_NONE ||
+		    end->value[i] == PERF_VALUE_NONE ||
+		    end->value[i] < start->value[i])
+			continue;
+		value = end->value[i] - start->value[i];
+		enabled = end->enabled[i] - start->enabled[i];
+		running = end->running[i] - start->running[i];
+		if (!running)
+			continue;
+		if (running < enabled)
+			delta[i] = (double)value * enabled / running;
+		else
+			delta[i] = value;
+	}
+}
+
+void perf_counters_print(FILE *f, const uint64_t *delta, double bytes)
+{
+	const char *sep = "";
+	double kb = bytes / 1024;
+	int i;
+
+	if (delta[PERF_CYCLES] != PERF_VALUE_NONE &&
+	    delta[PERF_INSTRUCTIONS] != PERF_VALUE_NONE &&
+	    delta[PERF_CYCLES]) {
+		fprintf(f, "IPC %.2f", (double)delta[PERF_INSTRUCTIONS] /
+				       delta[PERF_CYCLES]);
+		sep = ", ";
+	}
+	if (delta[PERF_CYCLES] != PERF_VALUE_NONE && kb > 0) {
+		fprintf(f, "%scycles/KB %.1f", sep, delta[PERF_CYCLES] / kb);
+		sep = ", ";
+	}
+	for (i = PERF_L1D_MISSES; i < PERF_EVENTS; i++) {
+		if (delta[i] == PERF_VALUE_NONE || kb <= 0)
+			continue;
+		fprintf(f, "%s%s/KB %.2f", sep, perf_event_names[i],
+			delta[i] / kb);
+		sep = ", ";
+	}
+	if (!*sep)
+		fprintf(f, "no counters");
+	fprintf(f, "\n");
+}
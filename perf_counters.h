@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2026 lima-memtester contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+enum {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_L1D_MISSES,
+	PERF_LLC_MISSES,
+	PERF_DTLB_MISSES,
+	PERF_BUS_ACCESSES,
+	PERF_EVENTS
+};
+
+/* The value of the events not supported by the PMU (or the kernel) */
+#define PERF_VALUE_NONE UINT64_MAX
+
+typedef struct perf_counters_t
+{
+	int fd[PERF_EVENTS];
+} perf_counters_t;
+
+/* The raw counts and the times the events were enabled and actually
+   counting (these differ when the PMU is multiplexed) */
+typedef struct perf_snapshot_t
+{
+	uint64_t value[PERF_EVENTS];
+	uint64_t enabled[PERF_EVENTS];
+	uint64_t running[PERF_EVENTS];
+} perf_snapshot_t;
+
+extern const char *const perf_event_names[PERF_EVENTS];
+
+/* Mark all the counters as not opened */
+void perf_counters_init(perf_counters_t *pc);
+
+/* Open the counters for the calling thread. Returns the number of events
+   supported by the PMU, 0 if none (errno is set then). */
+int perf_counters_open(perf_counters_t *pc);
+
+void perf_counters_close(perf_counters_t *pc);
+
+/* Read the current raw counts. Can be called from any thread of the
+   process. */
+void perf_counters_read(const perf_counters_t *pc, perf_snapshot_t *s);
+
+/* delta = end - start, scaled up by the ratio of the enabled and running
+   times between the snapshots if the PMU was multiplexed. PERF_VALUE_NONE
+   if either is not known or if the event did not run in between. */
+void perf_counters_delta(uint64_t *delta, const perf_snapshot_t *start,
+			 const perf_snapshot_t *end);
+
+/* Print the IPC and the misses per KB of the memory traffic of 'bytes' */
+void perf_counters_print(FILE *f, const uint64_t *delta, double bytes);
+
+#endif